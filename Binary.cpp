@@ -0,0 +1,241 @@
+/*
+    File:       Binary.cpp
+    Authors:    Matteo Loporchio, Davide Rucci
+
+    Computational Mathematics for Learning and Data Analysis 2018/2019
+*/
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include "Binary.hpp"
+
+namespace {
+
+const char QPB_MAGIC[8] = {'Q', 'P', 'B', 'I', 'N', 0, 0, 0};
+const size_t QPB_ALIGN = 64;
+const size_t QPB_CHUNK = 1 << 20;
+const uint64_t P1 = 0x9E3779B185EBCA87ULL, P2 = 0xC2B2AE3D27D4EB4FULL;
+
+inline uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+// Mixes the word w into the hash h.
+inline uint64_t mix(uint64_t h, uint64_t w) {
+    return rotl(h ^ (w * P2), 31) * P1;
+}
+
+// Hash of a chunk of n bytes (a multiple of 8), computed on four
+// independent lanes.
+uint64_t chunk_hash(const char *p, size_t n) {
+    uint64_t h[4] = {P1, P2, ~P1, ~P2}, w;
+    size_t m = n / 8, i = 0;
+    for (; i + 4 <= m; i += 4) {
+        for (int l = 0; l < 4; l++) {
+            std::memcpy(&w, p + 8 * (i + l), 8);
+            h[l] = mix(h[l], w);
+        }
+    }
+    for (; i < m; i++) {
+        std::memcpy(&w, p + 8 * i, 8);
+        h[0] = mix(h[0], w);
+    }
+    uint64_t r = n;
+    for (int l = 0; l < 4; l++) r = mix(r, h[l]);
+    return r;
+}
+
+// Returns n rounded up to a multiple of the alignment of the sections.
+inline size_t padded(size_t n) {
+    return (n + QPB_ALIGN - 1) / QPB_ALIGN * QPB_ALIGN;
+}
+
+// Returns the n indices of p as 64-bit integers, converting them into buf
+// only if they have a different size.
+template<typename iT>
+const void *as_u64(const iT *p, size_t n, std::vector<uint64_t> &buf) {
+    if (sizeof(iT) == sizeof(uint64_t)) return p;
+    buf.assign(p, p + n);
+    return buf.data();
+}
+
+/*
+    Writes a container: the header is written first with a null checksum,
+    then the sections, and finally the checksum is computed on the mapped
+    file and written into the header.
+*/
+void qpb_write(const std::string &path, qpb_kind_t kind, uint32_t elem_size,
+uint64_t n, uint64_t nnz, const void *val, const arma::uword *cptr,
+const arma::uword *ridx, const arma::vec &q, const std::vector<cidx_t> &off,
+const std::vector<cidx_t> &idx) {
+    if (q.n_elem != n) {
+        throw std::runtime_error("The sizes of Q and q do not match.");
+    }
+    bool sparse = (kind == QPB_CSC || kind == QPB_SPSYM);
+    std::vector<uint64_t> b_ptr, b_ridx, b_off, b_idx;
+    const void *data[QPB_NSECT] = {
+        q.memptr(), val,
+        (sparse) ? as_u64(cptr, n + 1, b_ptr) : nullptr,
+        (sparse) ? as_u64(ridx, nnz, b_ridx) : nullptr,
+        as_u64(off.data(), off.size(), b_off),
+        as_u64(idx.data(), idx.size(), b_idx)
+    };
+    size_t size[QPB_NSECT] = {
+        n * sizeof(double), nnz * elem_size,
+        (sparse) ? (n + 1) * sizeof(uint64_t) : 0,
+        (sparse) ? nnz * sizeof(uint64_t) : 0,
+        off.size() * sizeof(uint64_t), idx.size() * sizeof(uint64_t)
+    };
+    qpb_header_t h;
+    std::memset(&h, 0, sizeof(h));
+    std::memcpy(h.magic, QPB_MAGIC, sizeof(QPB_MAGIC));
+    h.version = QPB_VERSION;
+    h.kind = kind;
+    h.elem_size = elem_size;
+    h.symmetric = (kind == QPB_SYM || kind == QPB_SPSYM);
+    h.n = n;
+    h.k = off.size() - 1;
+    h.nnz = nnz;
+    h.n_idx = idx.size();
+    uint64_t pos = sizeof(h);
+    for (int s = 0; s < QPB_NSECT; s++) {
+        h.sect[s][0] = pos;
+        h.sect[s][1] = size[s];
+        pos += padded(size[s]);
+    }
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write((const char *) &h, sizeof(h));
+    const char zeros[QPB_ALIGN] = {0};
+    for (int s = 0; s < QPB_NSECT; s++) {
+        if (size[s] > 0) out.write((const char *) data[s], size[s]);
+        out.write(zeros, padded(size[s]) - size[s]);
+    }
+    out.close();
+    if (!out) throw std::runtime_error("Error while writing file: " + path);
+    mapping_t m = map_file(path);
+    h.checksum = qpb_checksum(m.data.get() + sizeof(h), m.size - sizeof(h));
+    std::fstream io(path, std::ios::binary | std::ios::in | std::ios::out);
+    io.seekp(offsetof(qpb_header_t, checksum));
+    io.write((const char *) &h.checksum, sizeof(h.checksum));
+    io.close();
+    if (!io) throw std::runtime_error("Error while writing file: " + path);
+}
+
+}
+
+// Computes the checksum of n bytes: the bytes are hashed in chunks of
+// 1 MB in parallel, then the hashes of the chunks are combined.
+uint64_t qpb_checksum(const char *p, size_t n) {
+    long long nc = (long long) ((n + QPB_CHUNK - 1) / QPB_CHUNK);
+    std::vector<uint64_t> hc(nc);
+    #pragma omp parallel for schedule(static)
+    for (long long c = 0; c < nc; c++) {
+        size_t lo = c * QPB_CHUNK;
+        hc[c] = chunk_hash(p + lo, std::min(QPB_CHUNK, n - lo));
+    }
+    uint64_t r = n;
+    for (uint64_t x : hc) r = mix(r, x);
+    return r;
+}
+
+// Maps a container and checks its header.
+qpb_file_t qpb_open(const std::string &path, bool verify, bool writable) {
+    qpb_file_t f;
+    f.map = map_file(path, writable);
+    if (f.map.size < sizeof(qpb_header_t) ||
+    std::memcmp(f.map.data.get(), QPB_MAGIC, sizeof(QPB_MAGIC)) != 0) {
+        throw std::runtime_error("Not a binary problem file: " + path);
+    }
+    f.h = (const qpb_header_t *) f.map.data.get();
+    const qpb_header_t &h = *f.h;
+    if (h.version != QPB_VERSION) {
+        throw std::runtime_error("Unsupported version " +
+        std::to_string(h.version) + " of binary problem file: " + path);
+    }
+    bool sparse = (h.kind == QPB_CSC || h.kind == QPB_SPSYM);
+    uint64_t size[QPB_NSECT] = {
+        h.n * sizeof(double), h.nnz * h.elem_size,
+        (sparse) ? (h.n + 1) * sizeof(uint64_t) : 0,
+        (sparse) ? h.nnz * sizeof(uint64_t) : 0,
+        (h.k + 1) * sizeof(uint64_t), h.n_idx * sizeof(uint64_t)
+    };
+    bool valid = (h.kind <= QPB_SPSYM) &&
+    (h.elem_size == sizeof(double) || h.elem_size == sizeof(float));
+    for (int s = 0; s < QPB_NSECT && valid; s++) {
+        valid = (h.sect[s][1] == size[s] && h.sect[s][0] % QPB_ALIGN == 0 &&
+        h.sect[s][0] >= sizeof(h) && h.sect[s][0] <= f.map.size &&
+        h.sect[s][1] <= f.map.size - h.sect[s][0]);
+    }
+    if (!valid) {
+        throw std::runtime_error("Corrupted header in binary problem file: "
+        + path);
+    }
+    if (verify && qpb_checksum(f.map.data.get() + sizeof(h),
+    f.map.size - sizeof(h)) != h.checksum) {
+        throw std::runtime_error("Wrong checksum in binary problem file: "
+        + path);
+    }
+    return f;
+}
+
+// Saves a problem with a dense matrix.
+template<typename eT>
+void save_binary(const std::string &path, const arma::Mat<eT> &Q,
+const arma::vec &q, const std::vector<cidx_t> &off,
+const std::vector<cidx_t> &idx) {
+    qpb_write(path, QPB_DENSE, sizeof(eT), Q.n_cols, Q.n_elem, Q.memptr(),
+    nullptr, nullptr, q, off, idx);
+}
+
+// Saves a problem with a sparse matrix.
+template<typename eT>
+void save_binary(const std::string &path, const arma::SpMat<eT> &Q,
+const arma::vec &q, const std::vector<cidx_t> &off,
+const std::vector<cidx_t> &idx) {
+    Q.sync();
+    qpb_write(path, QPB_CSC, sizeof(eT), Q.n_cols, Q.n_nonzero, Q.values,
+    Q.col_ptrs, Q.row_indices, q, off, idx);
+}
+
+// Saves a problem with a sparse matrix (always stored in CSC format).
+template<typename eT>
+void save_binary(const std::string &path, const spauto_t<eT> &Q,
+const arma::vec &q, const std::vector<cidx_t> &off,
+const std::vector<cidx_t> &idx) {
+    save_binary(path, Q.to_spmat(), q, off, idx);
+}
+
+// Saves a problem with a dense symmetric matrix.
+template<typename eT>
+void save_binary(const std::string &path, const symmat_t<eT> &Q,
+const arma::vec &q, const std::vector<cidx_t> &off,
+const std::vector<cidx_t> &idx) {
+    qpb_write(path, QPB_SYM, sizeof(eT), Q.n_cols, Q.a.n_elem, Q.a.memptr(),
+    nullptr, nullptr, q, off, idx);
+}
+
+// Saves a problem with a sparse symmetric matrix.
+template<typename eT>
+void save_binary(const std::string &path, const spsymmat_t<eT> &Q,
+const arma::vec &q, const std::vector<cidx_t> &off,
+const std::vector<cidx_t> &idx) {
+    Q.U.sync();
+    qpb_write(path, QPB_SPSYM, sizeof(eT), Q.n_cols, Q.U.n_nonzero,
+    Q.U.values, Q.U.col_ptrs, Q.U.row_indices, q, off, idx);
+}
+
+// Instances of the writers for double and single precision.
+#define QPB_SAVE(T) template void save_binary(const std::string &path, \
+const T &Q, const arma::vec &q, const std::vector<cidx_t> &off, \
+const std::vector<cidx_t> &idx);
+QPB_SAVE(arma::Mat<double>)
+QPB_SAVE(arma::Mat<float>)
+QPB_SAVE(arma::SpMat<double>)
+QPB_SAVE(arma::SpMat<float>)
+QPB_SAVE(spauto_t<double>)
+QPB_SAVE(spauto_t<float>)
+QPB_SAVE(symmat_t<double>)
+QPB_SAVE(symmat_t<float>)
+QPB_SAVE(spsymmat_t<double>)
+QPB_SAVE(spsymmat_t<float>)
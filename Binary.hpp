@@ -0,0 +1,124 @@
+/*
+    File:       Binary.hpp
+    Authors:    Matteo Loporchio, Davide Rucci
+
+    Computational Mathematics for Learning and Data Analysis 2018/2019
+*/
+
+#ifndef BINARY_H
+#define BINARY_H
+
+#define ARMA_DONT_USE_WRAPPER
+#include <armadillo>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Config.hpp"
+#include "MapFile.hpp"
+#include "SpFormats.hpp"
+#include "SymMatrix.hpp"
+
+/*
+    Binary container of a problem (file <name>.qpb), meant to be mapped in
+    memory instead of parsed. The file starts with a header of 256 bytes,
+    followed by the sections listed in the header. Each section starts at
+    a multiple of 64 bytes and is padded with zeros to a multiple of
+    64 bytes. All the numbers are stored in the byte order of the machine.
+
+        QPB_Q       q (n doubles)
+        QPB_QVAL    entries of Q (nnz values of elem_size bytes): all the
+                    entries by columns (QPB_DENSE), the nonzeros by columns
+                    (QPB_CSC, QPB_SPSYM) or the upper triangle packed by
+                    columns (QPB_SYM)
+        QPB_QPTR    column pointers of Q (n + 1 uint64, sparse kinds only)
+        QPB_QIDX    row indices of Q (nnz uint64, sparse kinds only)
+        QPB_COFF    offsets of the blocks of the constraints (k + 1 uint64)
+        QPB_CIDX    indices of all the blocks (uint64)
+
+    The checksum covers all the bytes after the header.
+*/
+const uint32_t QPB_VERSION = 1;
+
+// Storage of the Hessian.
+enum qpb_kind_t : uint32_t {
+    QPB_DENSE = 0,      // Dense matrix.
+    QPB_CSC = 1,        // Sparse matrix.
+    QPB_SYM = 2,        // Dense symmetric matrix (packed upper triangle).
+    QPB_SPSYM = 3       // Sparse symmetric matrix (upper triangle only).
+};
+
+// Sections of the file.
+enum qpb_sect_t {QPB_Q, QPB_QVAL, QPB_QPTR, QPB_QIDX, QPB_COFF, QPB_CIDX,
+QPB_NSECT};
+
+struct qpb_header_t {
+    char magic[8];              // "QPBIN" followed by zeros.
+    uint32_t version;           // Version of the format.
+    uint32_t kind;              // Storage of the Hessian (qpb_kind_t).
+    uint32_t elem_size;         // Size of the entries of Q (4 or 8).
+    uint32_t symmetric;         // 1 if only the upper triangle is stored.
+    uint64_t n;                 // Number of variables.
+    uint64_t k;                 // Number of blocks of the constraints.
+    uint64_t nnz;               // Number of stored entries of Q.
+    uint64_t n_idx;             // Number of indices of the constraints.
+    uint64_t sect[QPB_NSECT][2];        // Offset and size of each section.
+    uint64_t checksum;          // Checksum of the sections.
+    char pad[256 - 64 - 16 * QPB_NSECT];
+};
+
+static_assert(sizeof(qpb_header_t) == 256, "Unexpected size of the header.");
+
+// Container mapped in memory.
+struct qpb_file_t {
+    mapping_t map;                  // Mapping of the whole file.
+    const qpb_header_t *h = nullptr; // Header.
+
+    // Returns the first element of section s.
+    template<typename T>
+    const T *sect(qpb_sect_t s) const {
+        return (const T *) (map.data.get() + h->sect[s][0]);
+    }
+
+    // Releases the memory of section s (see map_release).
+    void release(qpb_sect_t s) const {
+        map_release(map.data.get() + h->sect[s][0], h->sect[s][1]);
+    }
+};
+
+// Computes the checksum of n bytes (a multiple of 8), in parallel.
+uint64_t qpb_checksum(const char *p, size_t n);
+
+// Maps a container and checks its header (and its checksum if verify
+// is true). Throws std::runtime_error if the file is not valid.
+// If writable is true, the file is mapped privately (see map_file).
+qpb_file_t qpb_open(const std::string &path, bool verify = QPB_VERIFY,
+bool writable = false);
+
+// Saves a problem into a container. The constraints are given by the
+// offsets and the indices of their blocks.
+template<typename eT>
+void save_binary(const std::string &path, const arma::Mat<eT> &Q,
+const arma::vec &q, const std::vector<cidx_t> &off,
+const std::vector<cidx_t> &idx);
+
+template<typename eT>
+void save_binary(const std::string &path, const arma::SpMat<eT> &Q,
+const arma::vec &q, const std::vector<cidx_t> &off,
+const std::vector<cidx_t> &idx);
+
+template<typename eT>
+void save_binary(const std::string &path, const spauto_t<eT> &Q,
+const arma::vec &q, const std::vector<cidx_t> &off,
+const std::vector<cidx_t> &idx);
+
+template<typename eT>
+void save_binary(const std::string &path, const symmat_t<eT> &Q,
+const arma::vec &q, const std::vector<cidx_t> &off,
+const std::vector<cidx_t> &idx);
+
+template<typename eT>
+void save_binary(const std::string &path, const spsymmat_t<eT> &Q,
+const arma::vec &q, const std::vector<cidx_t> &off,
+const std::vector<cidx_t> &idx);
+
+#endif
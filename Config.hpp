@@ -8,14 +8,83 @@
 #ifndef CONFIG_H
 #define CONFIG_H
 
+#include <cstdint>
+
 // Number of decimal digits to display when printing on the standard output.
 #define FP_STDOUT 6
 
 // Number of decimal digits to display when printing on a file.
 #define FP_FILE 16
 
-// If set to 1, objective function values are logged and saved onto a file
+// Default value of the <log> parameter of the solver: if set to 1,
+// objective function values are logged and saved onto a file
 // during the execution of the projected gradient method.
 #define LOG_VAL 0
 
+// If set to 1, the indices of the constraint list are stored as 32-bit
+// integers, halving the memory needed by the list. Only use this when the
+// number of variables is below 2^32.
+#define CST_IDX_32 0
+
+// Type of the indices stored in the constraint list and in the lists
+// of free variables.
+#if CST_IDX_32
+typedef uint32_t cidx_t;
+#else
+typedef uint64_t cidx_t;
+#endif
+
+// If set to 1, the variables are permuted before solving the problem, so
+// that each block of the constraint list is a contiguous range of indices.
+#define REORDER 1
+
+// If set to 1, the reordering of a sparse problem follows the reverse
+// Cuthill-McKee ordering of Q, which reduces its bandwidth.
+#define RCM 1
+
+// The blocks are kept contiguous by the reordering unless this makes the
+// mean distance of the entries of Q from the diagonal RCM_SLACK times
+// larger than sorting them by block only within windows of RCM_WINDOW
+// consecutive RCM ranks (or 8 times the number of blocks, if larger).
+// A window of 64K variables holds 512 KB of each vector: smaller problems
+// fit in the cache anyway and always keep their blocks contiguous.
+#define RCM_SLACK 2
+#define RCM_WINDOW 65536
+
+// Fraction of free variables above which the products with Q are computed
+// over the whole matrix instead of the columns of the free variables.
+#define MV_DENSITY 0.5
+
+// Number of rows of a dense Hessian processed at a time by the
+// matrix-vector products, so that the corresponding part of the vector
+// stays in the L1 cache.
+#define GEMV_BLOCK 2048
+
+// If set to 1, the checksum of a binary problem file is verified when
+// the file is loaded (which reads the whole file once).
+#define QPB_VERIFY 0
+
+// Size in megabytes of the tiles in which an out-of-core Hessian is read
+// from the disk.
+#define TILE_MB 64
+
+// Storage format of the sparse Hessian: -1 = chosen automatically from
+// the lengths of its rows, 0 = CSC, 1 = SELL-C-sigma, 2 = BCSR.
+#define SP_FORMAT -1
+
+// Number of consecutive rows sorted by length in the SELL-C-sigma format
+// (sigma, a multiple of the chunk size 8).
+#define SELL_SIGMA 256
+
+// When the Hessian is stored in single precision, the gradient is
+// recomputed from scratch every REFRESH iterations (0 = never).
+#define REFRESH 100
+
+// Size in megabytes of the cache of columns of a kernel Hessian.
+#define KCACHE_MB 512
+
+// Default number of threads used by the solver when compiled with OpenMP.
+// If set to 0, the OpenMP default (e.g. OMP_NUM_THREADS) is used.
+#define NUM_THREADS 0
+
 #endif
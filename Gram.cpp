@@ -0,0 +1,104 @@
+/*
+    File:       Gram.cpp
+    Authors:    Matteo Loporchio, Davide Rucci
+
+    Computational Mathematics for Learning and Data Analysis 2018/2019
+*/
+
+#ifndef GRAM_IMPL_
+#define GRAM_IMPL_
+
+#include "Gram.hpp"
+
+// Splits the columns of A (same number of nonzeros per range).
+template<typename eT>
+void split(const gram_t<eT> &Q, const cidx_t *idx, size_t n, size_t np,
+std::vector<size_t> &part) {
+    split(Q.A, idx, n, np, part);
+}
+
+// Computes t = A * v as the product of the transpose of A by v,
+// with np threads. The rows of A are split again only if np changes.
+template<typename eT>
+void gram_fwd(const gram_t<eT> &Q, const arma::vec &v, size_t np) {
+    fit(Q.t, Q.A.n_rows);
+    if (Q.rpart.size() != np + 1) {
+        fit(Q.rpart, np + 1);
+        split(Q.At, nullptr, Q.At.n_cols, np, Q.rpart);
+    }
+    mul(Q.At, 1, v, Q.t, Q.rpart);
+}
+
+// Computes y = alpha * A^T * (A * v).
+template<typename eT>
+void mul(const gram_t<eT> &Q, double alpha, const arma::vec &v, arma::vec &y,
+const std::vector<size_t> &part) {
+    gram_fwd(Q, v, part.size() - 1);
+    mul(Q.A, alpha, Q.t, y, part);
+}
+
+// Computes l = alpha * A^T * (A * d) and returns d^T * l, which is
+// alpha * ||A * d||^2.
+template<typename eT>
+double mul_dot(const gram_t<eT> &Q, double alpha, const arma::vec &d,
+arma::vec &l, const std::vector<size_t> &part) {
+    gram_fwd(Q, d, part.size() - 1);
+    mul(Q.A, alpha, Q.t, l, part);
+    return alpha * arma::dot(Q.t, Q.t);
+}
+
+// Computes l = alpha * A^T * (A * d) on the support of d and returns
+// d^T * l. The product A * d is accumulated from the columns of A in the
+// support, then each component of l is a dot product with t.
+template<typename eT>
+double mul_dot(const gram_t<eT> &Q, double alpha, const arma::vec &d,
+arma::vec &l, const cidx_t *idx, size_t n, const std::vector<size_t> &part) {
+    Q.A.sync();
+    const arma::uword *cp = Q.A.col_ptrs, *ri = Q.A.row_indices;
+    const eT *v = Q.A.values;
+    const double *pd = d.memptr();
+    double *pl = l.memptr();
+    fit(Q.t, Q.A.n_rows);
+    Q.t.zeros();
+    double *pt = Q.t.memptr();
+    for (size_t a = 0; a < n; a++) {
+        cidx_t j = idx[a];
+        for (arma::uword k = cp[j]; k < cp[j + 1]; k++) pt[ri[k]] += v[k] * pd[j];
+    }
+    int np = (int) part.size() - 1;
+    #pragma omp parallel for num_threads(np) schedule(static, 1)
+    for (int t = 0; t < np; t++) {
+        for (size_t a = part[t]; a < part[t + 1]; a++) {
+            cidx_t i = idx[a];
+            double s = 0;
+            for (arma::uword k = cp[i]; k < cp[i + 1]; k++) s += v[k] * pt[ri[k]];
+            pl[i] = alpha * s;
+        }
+    }
+    return alpha * arma::dot(Q.t, Q.t);
+}
+
+// Applies the symmetric permutation Q = Q(p, p), which permutes
+// the columns of A.
+template<typename eT>
+void permute(gram_t<eT> &Q, const arma::uvec &p) {
+    arma::uvec inv(p.n_elem);
+    inv.elem(p) = arma::regspace<arma::uvec>(0, p.n_elem - 1);
+    arma::umat loc(2, Q.A.n_nonzero);
+    arma::Col<eT> val(Q.A.n_nonzero);
+    arma::uword k = 0;
+    for (auto it = Q.A.begin(); it != Q.A.end(); ++it) {
+        loc(0, k) = it.row();
+        loc(1, k) = inv(it.col());
+        val(k++) = (*it);
+    }
+    Q.set(arma::SpMat<eT>(loc, val, Q.A.n_rows, Q.A.n_cols));
+}
+
+// Factored matrices are treated as dense: their pattern is not formed.
+template<typename eT>
+bool pattern(const gram_t<eT> &, arma::uvec &, arma::uvec &) {
+    return false;
+}
+
+#endif
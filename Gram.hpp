@@ -0,0 +1,81 @@
+/*
+    File:       Gram.hpp
+    Authors:    Matteo Loporchio, Davide Rucci
+
+    Computational Mathematics for Learning and Data Analysis 2018/2019
+*/
+
+#ifndef GRAM_H
+#define GRAM_H
+
+#define ARMA_DONT_USE_WRAPPER
+#include <armadillo>
+#include <vector>
+#include "Kernels.hpp"
+
+/*
+    Hessian in factored form Q = A^T * A, where A is a sparse m x n matrix,
+    as in the least squares problems min ||A * x - b||^2 (whose linear
+    part is q = -2 * A^T * b). Q is never formed: a product with Q is
+    computed as A^T * (A * d), with two sparse products. This takes
+    O(nnz(A)) memory and time instead of O(n^2) for a dense Q.
+    A is also stored by rows (as its transpose), so that both products
+    are computed as dot products and run in parallel.
+*/
+template<typename eT>
+struct gram_t {
+    typedef eT elem_type;
+
+    arma::uword n_rows = 0;     // Number of rows of Q (columns of A).
+    arma::uword n_cols = 0;     // Number of columns of Q (columns of A).
+    arma::SpMat<eT> A;          // Factor of Q.
+    arma::SpMat<eT> At;         // Transpose of the factor.
+    mutable arma::vec t;        // Buffer for the product A * d.
+    mutable std::vector<size_t> rpart;  // Split of the rows of A.
+
+    gram_t() {}
+    gram_t(arma::SpMat<eT> F) { set(std::move(F)); }
+
+    // Sets the factor of Q (moved into the struct).
+    void set(arma::SpMat<eT> F) {
+        n_rows = n_cols = F.n_cols;
+        At = F.t();
+        A = std::move(F);
+        rpart.clear();
+    }
+};
+
+/*
+    The following functions implement the Hessian operator concept
+    (see Operator.hpp) for a factored Q. The ranges of part are made of
+    columns of A, with the same number of nonzeros. The products restricted
+    to the support of d only read the columns of A in the support.
+    Factored matrices are not reordered by RCM, since the pattern of Q
+    is not available.
+*/
+template<typename eT>
+void split(const gram_t<eT> &Q, const cidx_t *idx, size_t n, size_t np,
+std::vector<size_t> &part);
+
+template<typename eT>
+void mul(const gram_t<eT> &Q, double alpha, const arma::vec &v, arma::vec &y,
+const std::vector<size_t> &part);
+
+template<typename eT>
+double mul_dot(const gram_t<eT> &Q, double alpha, const arma::vec &d,
+arma::vec &l, const std::vector<size_t> &part);
+
+template<typename eT>
+double mul_dot(const gram_t<eT> &Q, double alpha, const arma::vec &d,
+arma::vec &l, const cidx_t *idx, size_t n, const std::vector<size_t> &part);
+
+template<typename eT>
+void permute(gram_t<eT> &Q, const arma::uvec &p);
+
+template<typename eT>
+bool pattern(const gram_t<eT> &Q, arma::uvec &cp, arma::uvec &ri);
+
+// The actual implementation is defined in the file Gram.cpp.
+#include "Gram.cpp"
+
+#endif
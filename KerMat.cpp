@@ -0,0 +1,225 @@
+/*
+    File:       KerMat.cpp
+    Authors:    Matteo Loporchio, Davide Rucci
+
+    Computational Mathematics for Learning and Data Analysis 2018/2019
+*/
+
+#ifndef KERMAT_IMPL_
+#define KERMAT_IMPL_
+
+#include <algorithm>
+#include <cmath>
+#include "KerMat.hpp"
+
+// Sets the features, the kernel and the labels, with a cache of
+// mb megabytes (at most one slot per column).
+template<typename eT>
+void kermat_t<eT>::set(arma::mat X, const kerfun_t &K, arma::vec y,
+double mb) {
+    n_rows = n_cols = X.n_cols;
+    sq = arma::sum(arma::square(X), 0).t();
+    this->X = std::move(X);
+    this->K = K;
+    this->y = std::move(y);
+    double col_size = (double) n_rows * sizeof(eT);
+    cap = (n_rows > 0) ? (size_t) std::min<double>(n_rows,
+        std::floor(mb * 1024 * 1024 / col_size)) : 0;
+    cols.set_size(n_rows, cap);
+    clear();
+}
+
+// Empties the cache.
+template<typename eT>
+void kermat_t<eT>::clear() {
+    slot.assign(n_cols, NONE);
+    owner.assign(cap, NONE);
+    prev.assign(cap, NONE);
+    next.assign(cap, NONE);
+    head = tail = NONE;
+    used = 0;
+}
+
+// Computes Q(i, j).
+template<typename eT>
+double kermat_t<eT>::at(arma::uword i, arma::uword j) const {
+    double k = vdot(X.colptr(i), X.colptr(j), X.n_rows);
+    switch (K.type) {
+        case KER_RBF:
+            k = std::exp(-K.gamma * std::max(sq(i) + sq(j) - 2 * k, 0.0));
+            break;
+        case KER_POLY:
+            k = std::pow(K.gamma * k + K.coef0, K.degree);
+            break;
+        default:
+            break;
+    }
+    return (y.n_elem > 0) ? y(i) * y(j) * k : k;
+}
+
+// Removes slot s from the list of the slots in use.
+template<typename eT>
+inline void kermat_unlink(const kermat_t<eT> &Q, arma::uword s) {
+    arma::uword p = Q.prev[s], n = Q.next[s];
+    if (p != Q.NONE) Q.next[p] = n;
+    else Q.head = n;
+    if (n != Q.NONE) Q.prev[n] = p;
+    else Q.tail = p;
+}
+
+// Inserts slot s at the head of the list, as the most recently used.
+template<typename eT>
+inline void kermat_push(const kermat_t<eT> &Q, arma::uword s) {
+    Q.prev[s] = Q.NONE;
+    Q.next[s] = Q.head;
+    if (Q.head != Q.NONE) Q.prev[Q.head] = s;
+    else Q.tail = s;
+    Q.head = s;
+}
+
+/*
+    Loads the n columns listed in idx into the cache, which must have at
+    least n slots. The columns already cached are moved to the head of the
+    list first, so that the evicted columns (taken from the tail) are never
+    among the ones requested: both a hit and an eviction take O(1). The
+    missing columns are then computed in parallel.
+*/
+template<typename eT>
+void kermat_fetch(const kermat_t<eT> &Q, const cidx_t *idx, size_t n,
+int np) {
+    fit(Q.miss, n);
+    size_t nm = 0;
+    for (size_t a = 0; a < n; a++) {
+        cidx_t j = idx[a];
+        arma::uword s = Q.slot[j];
+        if (s == Q.NONE) Q.miss[nm++] = j;
+        else if (s != Q.head) {
+            kermat_unlink(Q, s);
+            kermat_push(Q, s);
+        }
+    }
+    Q.miss.resize(nm);
+    for (cidx_t j : Q.miss) {
+        arma::uword s = Q.used;
+        if (Q.used < Q.cap) Q.used++;
+        else {
+            s = Q.tail;
+            kermat_unlink(Q, s);
+            Q.slot[Q.owner[s]] = Q.NONE;
+        }
+        Q.owner[s] = j;
+        Q.slot[j] = s;
+        kermat_push(Q, s);
+    }
+    #pragma omp parallel for num_threads(np) schedule(dynamic)
+    for (int a = 0; a < (int) nm; a++) {
+        cidx_t j = Q.miss[a];
+        eT *c = Q.cols.colptr(Q.slot[j]);
+        for (arma::uword i = 0; i < Q.n_rows; i++) c[i] = (eT) Q.at(i, j);
+    }
+}
+
+// Lists the nonzero components of v.
+template<typename eT>
+void kermat_nz(const kermat_t<eT> &Q, const arma::vec &v) {
+    fit(Q.nz, v.n_elem);
+    size_t m = 0;
+    for (arma::uword j = 0; j < v.n_elem; j++) {
+        if (v(j) != 0) Q.nz[m++] = (cidx_t) j;
+    }
+    Q.nz.resize(m);
+}
+
+// Splits the variables in np ranges of the same size.
+template<typename eT>
+void split(const kermat_t<eT> &Q, const cidx_t *idx, size_t n, size_t np,
+std::vector<size_t> &part) {
+    split_even((idx) ? n : Q.n_cols, np, part);
+}
+
+// Computes y = alpha * Q * v as a combination of the columns of the
+// nonzero components of v. The columns that do not fit in the cache are
+// computed on the fly.
+template<typename eT>
+void mul(const kermat_t<eT> &Q, double alpha, const arma::vec &v,
+arma::vec &y, const std::vector<size_t> &part) {
+    int np = (int) part.size() - 1;
+    const double *pv = v.memptr();
+    double *py = y.memptr();
+    kermat_nz(Q, v);
+    kermat_fetch(Q, Q.nz.data(), std::min(Q.nz.size(), Q.cap), np);
+    #pragma omp parallel for num_threads(np) schedule(static, 1)
+    for (int t = 0; t < np; t++) {
+        size_t lo = part[t], hi = part[t + 1];
+        std::fill(py + lo, py + hi, 0.0);
+        for (cidx_t j : Q.nz) {
+            double a = alpha * pv[j];
+            if (Q.slot[j] != Q.NONE) {
+                const eT *c = Q.cols.colptr(Q.slot[j]);
+                for (size_t i = lo; i < hi; i++) py[i] += c[i] * a;
+            }
+            else {
+                for (size_t i = lo; i < hi; i++) py[i] += Q.at(i, j) * a;
+            }
+        }
+    }
+}
+
+// Computes l = alpha * Q * d and returns d^T * l.
+template<typename eT>
+double mul_dot(const kermat_t<eT> &Q, double alpha, const arma::vec &d,
+arma::vec &l, const std::vector<size_t> &part) {
+    mul(Q, alpha, d, l, part);
+    return arma::dot(d, l);
+}
+
+// Computes l = alpha * Q * d on the support of d and returns d^T * l.
+// Since Q is symmetric, each component of l is a dot product with the
+// column of the same index, read from the cache when available. If the
+// support does not fit in the cache, its first columns are kept there,
+// so that the same columns are hit at the next iterations.
+template<typename eT>
+double mul_dot(const kermat_t<eT> &Q, double alpha, const arma::vec &d,
+arma::vec &l, const cidx_t *idx, size_t n, const std::vector<size_t> &part) {
+    int np = (int) part.size() - 1;
+    const double *pd = d.memptr();
+    double *pl = l.memptr(), dl = 0;
+    kermat_fetch(Q, idx, std::min(n, Q.cap), np);
+    #pragma omp parallel for num_threads(np) schedule(static, 1) \
+    reduction(+:dl)
+    for (int t = 0; t < np; t++) {
+        for (size_t a = part[t]; a < part[t + 1]; a++) {
+            cidx_t i = idx[a];
+            double s = 0;
+            if (Q.slot[i] != Q.NONE) {
+                s = vdot_idx(Q.cols.colptr(Q.slot[i]), pd, idx, n);
+            }
+            else {
+                for (size_t b = 0; b < n; b++) {
+                    if (pd[idx[b]] != 0) s += Q.at(i, idx[b]) * pd[idx[b]];
+                }
+            }
+            pl[i] = alpha * s;
+            dl += pd[i] * pl[i];
+        }
+    }
+    return dl;
+}
+
+// Applies the symmetric permutation Q = Q(p, p), which permutes the
+// columns of X and the labels, and empties the cache.
+template<typename eT>
+void permute(kermat_t<eT> &Q, const arma::uvec &p) {
+    Q.X = Q.X.cols(p);
+    Q.sq = Q.sq.elem(p);
+    if (Q.y.n_elem > 0) Q.y = Q.y.elem(p);
+    Q.clear();
+}
+
+// Kernel matrices are dense, so they have no pattern.
+template<typename eT>
+bool pattern(const kermat_t<eT> &, arma::uvec &, arma::uvec &) {
+    return false;
+}
+
+#endif
@@ -0,0 +1,115 @@
+/*
+    File:       KerMat.hpp
+    Authors:    Matteo Loporchio, Davide Rucci
+
+    Computational Mathematics for Learning and Data Analysis 2018/2019
+*/
+
+#ifndef KERMAT_H
+#define KERMAT_H
+
+#define ARMA_DONT_USE_WRAPPER
+#include <armadillo>
+#include <vector>
+#include "Kernels.hpp"
+
+// Kernel functions.
+enum kertype_t {
+    KER_LINEAR,     // K(a, b) = a^T * b
+    KER_RBF,        // K(a, b) = exp(-gamma * ||a - b||^2)
+    KER_POLY        // K(a, b) = (gamma * a^T * b + coef0)^degree
+};
+
+// Kernel function and its parameters.
+struct kerfun_t {
+    kertype_t type = KER_LINEAR;
+    double gamma = 1;
+    double coef0 = 0;
+    int degree = 3;
+};
+
+/*
+    Kernel Hessian Q(i, j) = y(i) * y(j) * K(x_i, x_j), where x_i is the
+    i-th column of the feature matrix X and y is an optional vector of
+    labels (as in the dual of a support vector machine). The entries of Q
+    are computed on demand from X, which takes O(n * m) memory for m
+    features instead of O(n^2).
+    The columns of Q used by the products are kept in a cache of bounded
+    size, from which the least recently used column is evicted. Since the
+    direction is zero outside the free variables, and the set of free
+    variables only shrinks, the same columns are needed at each iteration
+    and are computed only once as long as they fit in the cache.
+*/
+template<typename eT>
+struct kermat_t {
+    typedef eT elem_type;
+
+    arma::uword n_rows = 0;     // Number of rows.
+    arma::uword n_cols = 0;     // Number of columns.
+    arma::mat X;                // Features (one column per variable).
+    arma::vec y;                // Labels (empty if none).
+    arma::vec sq;               // Squared norms of the columns of X.
+    kerfun_t K;                 // Kernel function.
+
+    // Column cache: slot[j] is the slot of the j-th column of Q (or
+    // NONE) and owner[s] the column in slot s. The slots in use are
+    // linked by prev and next from the most recently used one (head) to
+    // the least recently used one (tail), which is evicted first.
+    static constexpr arma::uword NONE = (arma::uword) -1;
+    size_t cap = 0;                             // Number of slots.
+    mutable arma::Mat<eT> cols;                 // Cached columns.
+    mutable std::vector<arma::uword> slot, owner, prev, next;
+    mutable arma::uword head = NONE, tail = NONE;
+    mutable size_t used = 0;                    // Slots used so far.
+    mutable std::vector<cidx_t> miss, nz;       // Buffers.
+
+    kermat_t() {}
+    kermat_t(arma::mat X, const kerfun_t &K, arma::vec y, double mb) {
+        set(std::move(X), K, std::move(y), mb);
+    }
+
+    // Sets the features, the kernel and the labels (moved into the
+    // struct), with a cache of mb megabytes.
+    void set(arma::mat X, const kerfun_t &K, arma::vec y, double mb);
+
+    // Empties the cache.
+    void clear();
+
+    // Computes Q(i, j).
+    double at(arma::uword i, arma::uword j) const;
+};
+
+/*
+    The following functions implement the Hessian operator concept
+    (see Operator.hpp) for a kernel Hessian. Each range of part gets the
+    same number of variables. The products read the columns of the nonzero
+    components of the vector from the cache, or compute the needed entries
+    directly when they do not fit in it.
+    Kernel matrices are not reordered by RCM, since Q is dense.
+*/
+template<typename eT>
+void split(const kermat_t<eT> &Q, const cidx_t *idx, size_t n, size_t np,
+std::vector<size_t> &part);
+
+template<typename eT>
+void mul(const kermat_t<eT> &Q, double alpha, const arma::vec &v,
+arma::vec &y, const std::vector<size_t> &part);
+
+template<typename eT>
+double mul_dot(const kermat_t<eT> &Q, double alpha, const arma::vec &d,
+arma::vec &l, const std::vector<size_t> &part);
+
+template<typename eT>
+double mul_dot(const kermat_t<eT> &Q, double alpha, const arma::vec &d,
+arma::vec &l, const cidx_t *idx, size_t n, const std::vector<size_t> &part);
+
+template<typename eT>
+void permute(kermat_t<eT> &Q, const arma::uvec &p);
+
+template<typename eT>
+bool pattern(const kermat_t<eT> &Q, arma::uvec &cp, arma::uvec &ri);
+
+// The actual implementation is defined in the file KerMat.cpp.
+#include "KerMat.cpp"
+
+#endif
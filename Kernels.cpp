@@ -0,0 +1,539 @@
+/*
+    File:       Kernels.cpp
+    Authors:    Matteo Loporchio, Davide Rucci
+
+    Computational Mathematics for Learning and Data Analysis 2018/2019
+*/
+
+#ifndef KERNELS_IMPL_
+#define KERNELS_IMPL_
+
+#include <algorithm>
+#include "Kernels.hpp"
+
+/*
+    Computes y(i) = alpha * Q(:, i)^T * v for the columns i in [lo, hi).
+    The rows are processed in blocks of GEMV_BLOCK, so that the block of v
+    stays in cache while the columns are streamed four at a time.
+*/
+template<typename eT>
+inline void gemv(const arma::Mat<eT> &Q, double alpha, const double *v,
+double *y, size_t lo, size_t hi) {
+    std::fill(y + lo, y + hi, 0.0);
+    for (arma::uword r = 0; r < Q.n_rows; r += GEMV_BLOCK) {
+        size_t len = std::min<size_t>(GEMV_BLOCK, Q.n_rows - r);
+        size_t i = lo;
+        for (; i + 4 <= hi; i += 4) {
+            const eT *a[4] = {Q.colptr(i) + r, Q.colptr(i + 1) + r,
+                Q.colptr(i + 2) + r, Q.colptr(i + 3) + r};
+            double s[4];
+            vdot4(a, v + r, len, s);
+            y[i] += s[0];
+            y[i + 1] += s[1];
+            y[i + 2] += s[2];
+            y[i + 3] += s[3];
+        }
+        for (; i < hi; i++) y[i] += vdot(Q.colptr(i) + r, v + r, len);
+    }
+    for (size_t i = lo; i < hi; i++) y[i] *= alpha;
+}
+
+// Splits the n columns in np ranges with the same number of columns.
+inline void split_even(size_t n, size_t np, std::vector<size_t> &part) {
+    part.resize(np + 1);
+    for (size_t t = 0; t <= np; t++) part[t] = (n * t) / np;
+}
+
+// Splits the n positions of idx in np ranges with about the same total
+// cost, where cost(i) is the work needed by index i.
+template<typename F>
+void split_cost(const cidx_t *idx, size_t n, size_t np,
+std::vector<size_t> &part, F cost) {
+    part.resize(np + 1);
+    part[0] = 0;
+    size_t total = 0, t = 1, acc = 0;
+    for (size_t a = 0; a < n; a++) total += cost(idx[a]);
+    for (size_t a = 0; a < n && t < np; a++) {
+        while (t < np && acc >= (total * t) / np) part[t++] = a;
+        acc += cost(idx[a]);
+    }
+    while (t < np) part[t++] = n;
+    part[np] = n;
+}
+
+// Splits the columns of a dense matrix (same number of columns per range).
+template<typename eT>
+void split(const arma::Mat<eT> &Q, const cidx_t *idx, size_t n, size_t np,
+std::vector<size_t> &part) {
+    split_even((idx) ? n : Q.n_cols, np, part);
+}
+
+// Splits the columns of a sparse matrix (same number of nonzeros per range).
+template<typename eT>
+void split(const arma::SpMat<eT> &Q, const cidx_t *idx, size_t n, size_t np,
+std::vector<size_t> &part) {
+    Q.sync();
+    const arma::uword *cp = Q.col_ptrs;
+    part.resize(np + 1);
+    part[0] = 0;
+    if (!idx) {
+        // The column pointers are already the prefix sums of the nonzeros.
+        for (size_t t = 1; t < np; t++) {
+            arma::uword target = (Q.n_nonzero * t) / np;
+            part[t] = std::lower_bound(cp, cp + Q.n_cols, target) - cp;
+        }
+        part[np] = Q.n_cols;
+        return;
+    }
+    split_cost(idx, n, np, part,
+    [&](cidx_t i) { return cp[i + 1] - cp[i]; });
+}
+
+// Computes y = alpha * Q * v (dense version).
+template<typename eT>
+void mul(const arma::Mat<eT> &Q, double alpha, const arma::vec &v, arma::vec &y,
+const std::vector<size_t> &part) {
+    const double *pv = v.memptr();
+    double *py = y.memptr();
+    int np = (int) part.size() - 1;
+    #pragma omp parallel for num_threads(np) schedule(static, 1)
+    for (int t = 0; t < np; t++) {
+        gemv(Q, alpha, pv, py, part[t], part[t + 1]);
+    }
+}
+
+// Computes y = alpha * Q * v (sparse version). Like the other CSC kernels,
+// it indexes v and y with the row indices of Q unchecked: QProblem makes
+// sure that Q is n x n when it is built.
+template<typename eT>
+void mul(const arma::SpMat<eT> &Q, double alpha, const arma::vec &v,
+arma::vec &y, const std::vector<size_t> &part) {
+    Q.sync();
+    const arma::uword *cp = Q.col_ptrs, *ri = Q.row_indices;
+    const eT *val = Q.values;
+    const double *pv = v.memptr();
+    double *py = y.memptr();
+    int np = (int) part.size() - 1;
+    #pragma omp parallel for num_threads(np) schedule(static, 1)
+    for (int t = 0; t < np; t++) {
+        for (size_t i = part[t]; i < part[t + 1]; i++) {
+            double s = 0;
+            for (arma::uword k = cp[i]; k < cp[i + 1]; k++) {
+                s += val[k] * pv[ri[k]];
+            }
+            py[i] = alpha * s;
+        }
+    }
+}
+
+// Computes l = alpha * Q * d and returns d^T * l (dense version).
+template<typename eT>
+double mul_dot(const arma::Mat<eT> &Q, double alpha, const arma::vec &d,
+arma::vec &l, const std::vector<size_t> &part) {
+    const double *pd = d.memptr();
+    double *pl = l.memptr(), dl = 0;
+    int np = (int) part.size() - 1;
+    #pragma omp parallel for num_threads(np) schedule(static, 1) \
+    reduction(+:dl)
+    for (int t = 0; t < np; t++) {
+        gemv(Q, alpha, pd, pl, part[t], part[t + 1]);
+        for (size_t i = part[t]; i < part[t + 1]; i++) dl += pd[i] * pl[i];
+    }
+    return dl;
+}
+
+// Computes l = alpha * Q * d and returns d^T * l (sparse version).
+template<typename eT>
+double mul_dot(const arma::SpMat<eT> &Q, double alpha, const arma::vec &d,
+arma::vec &l, const std::vector<size_t> &part) {
+    Q.sync();
+    const arma::uword *cp = Q.col_ptrs, *ri = Q.row_indices;
+    const eT *v = Q.values;
+    const double *pd = d.memptr();
+    double *pl = l.memptr(), dl = 0;
+    int np = (int) part.size() - 1;
+    #pragma omp parallel for num_threads(np) schedule(static, 1) \
+    reduction(+:dl)
+    for (int t = 0; t < np; t++) {
+        for (size_t i = part[t]; i < part[t + 1]; i++) {
+            double s = 0;
+            for (arma::uword k = cp[i]; k < cp[i + 1]; k++) {
+                s += v[k] * pd[ri[k]];
+            }
+            pl[i] = alpha * s;
+            dl += pd[i] * pl[i];
+        }
+    }
+    return dl;
+}
+
+// Computes l = alpha * Q * d on the support of d and returns d^T * l
+// (dense version).
+template<typename eT>
+double mul_dot(const arma::Mat<eT> &Q, double alpha, const arma::vec &d,
+arma::vec &l, const cidx_t *idx, size_t n, const std::vector<size_t> &part) {
+    const double *pd = d.memptr();
+    double *pl = l.memptr(), dl = 0;
+    int np = (int) part.size() - 1;
+    #pragma omp parallel for num_threads(np) schedule(static, 1) \
+    reduction(+:dl)
+    for (int t = 0; t < np; t++) {
+        for (size_t a = part[t]; a < part[t + 1]; a++) {
+            pl[idx[a]] = alpha * vdot_idx(Q.colptr(idx[a]), pd, idx, n);
+            dl += pd[idx[a]] * pl[idx[a]];
+        }
+    }
+    return dl;
+}
+
+// Computes l = alpha * Q * d on the support of d and returns d^T * l
+// (sparse version).
+template<typename eT>
+double mul_dot(const arma::SpMat<eT> &Q, double alpha, const arma::vec &d,
+arma::vec &l, const cidx_t *idx, size_t /* n */,
+const std::vector<size_t> &part) {
+    Q.sync();
+    const arma::uword *cp = Q.col_ptrs, *ri = Q.row_indices;
+    const eT *v = Q.values;
+    const double *pd = d.memptr();
+    double *pl = l.memptr(), dl = 0;
+    int np = (int) part.size() - 1;
+    #pragma omp parallel for num_threads(np) schedule(static, 1) \
+    reduction(+:dl)
+    for (int t = 0; t < np; t++) {
+        for (size_t a = part[t]; a < part[t + 1]; a++) {
+            cidx_t i = idx[a];
+            double s = 0;
+            for (arma::uword k = cp[i]; k < cp[i + 1]; k++) {
+                s += v[k] * pd[ri[k]];
+            }
+            pl[i] = alpha * s;
+            dl += pd[i] * pl[i];
+        }
+    }
+    return dl;
+}
+
+// Symmetric formats are processed by a single thread.
+template<typename eT>
+void split(const symmat_t<eT> &Q, const cidx_t *idx, size_t n, size_t /* np */,
+std::vector<size_t> &part) {
+    split_even((idx) ? n : Q.n_cols, 1, part);
+}
+
+template<typename eT>
+void split(const spsymmat_t<eT> &Q, const cidx_t *idx, size_t n,
+size_t /* np */, std::vector<size_t> &part) {
+    split_even((idx) ? n : Q.n_cols, 1, part);
+}
+
+// Computes y = alpha * Q * v (packed symmetric version).
+template<typename eT>
+void mul(const symmat_t<eT> &Q, double alpha, const arma::vec &v, arma::vec &y,
+const std::vector<size_t> &part) {
+    mul_dot(Q, alpha, v, y, part);
+}
+
+// Computes y = alpha * Q * v (sparse symmetric version).
+template<typename eT>
+void mul(const spsymmat_t<eT> &Q, double alpha, const arma::vec &v, arma::vec &y,
+const std::vector<size_t> &part) {
+    mul_dot(Q, alpha, v, y, part);
+}
+
+/*
+    Computes l = alpha * Q * d and returns d^T * l (packed symmetric version).
+    Column j of the upper triangle gives the dot product s = U(0:j-1, j)^T *
+    d(0:j-1) for l(j) and is added, scaled by d(j), to l(0:j-1).
+    Since columns are visited in order, l(j) is complete after column j
+    has been processed, apart from the contributions of the following
+    columns. Moreover, d^T * Q * d = sum_j d(j) * (2 * s + U(j, j) * d(j)).
+*/
+template<typename eT>
+double mul_dot(const symmat_t<eT> &Q, double alpha, const arma::vec &d,
+arma::vec &l, const std::vector<size_t> &/* part */) {
+    const double *pd = d.memptr();
+    double *pl = l.memptr(), dl = 0;
+    for (arma::uword j = 0; j < Q.n_cols; j++) {
+        const eT *col = Q.colptr(j);
+        double dj = pd[j], aj = alpha * dj;
+        double s = vdot_axpy(col, pd, pl, aj, j);
+        pl[j] = alpha * s + col[j] * aj;
+        dl += dj * (2 * s + col[j] * dj);
+    }
+    return alpha * dl;
+}
+
+// Computes l = alpha * Q * d and returns d^T * l (sparse symmetric version).
+template<typename eT>
+double mul_dot(const spsymmat_t<eT> &Q, double alpha, const arma::vec &d,
+arma::vec &l, const std::vector<size_t> &/* part */) {
+    Q.U.sync();
+    const arma::uword *cp = Q.U.col_ptrs, *ri = Q.U.row_indices;
+    const eT *v = Q.U.values;
+    const double *pd = d.memptr();
+    double *pl = l.memptr(), dl = 0;
+    for (arma::uword j = 0; j < Q.n_cols; j++) {
+        double dj = pd[j], aj = alpha * dj, s = 0, djj = 0;
+        for (arma::uword k = cp[j]; k < cp[j + 1]; k++) {
+            arma::uword r = ri[k];
+            if (r == j) { djj = v[k]; continue; }
+            s += v[k] * pd[r];
+            pl[r] += v[k] * aj;
+        }
+        pl[j] = alpha * s + djj * aj;
+        dl += dj * (2 * s + djj * dj);
+    }
+    return alpha * dl;
+}
+
+// Computes l = alpha * Q * d on the support of d and returns d^T * l
+// (packed symmetric version).
+template<typename eT>
+double mul_dot(const symmat_t<eT> &Q, double alpha, const arma::vec &d,
+arma::vec &l, const cidx_t *idx, size_t n,
+const std::vector<size_t> &/* part */) {
+    const double *pd = d.memptr();
+    double *pl = l.memptr(), dl = 0;
+    for (size_t a = 0; a < n; a++) pl[idx[a]] = 0;
+    for (size_t a = 0; a < n; a++) {
+        cidx_t j = idx[a];
+        const eT *col = Q.colptr(j);
+        double dj = pd[j], aj = alpha * dj, s = 0;
+        for (size_t b = 0; b < n; b++) {
+            cidx_t r = idx[b];
+            if (r >= j) continue;
+            s += col[r] * pd[r];
+            pl[r] += col[r] * aj;
+        }
+        pl[j] += alpha * s + col[j] * aj;
+        dl += dj * (2 * s + col[j] * dj);
+    }
+    return alpha * dl;
+}
+
+// Computes l = alpha * Q * d on the support of d and returns d^T * l
+// (sparse symmetric version). The entries of l outside the support
+// are left unspecified.
+template<typename eT>
+double mul_dot(const spsymmat_t<eT> &Q, double alpha, const arma::vec &d,
+arma::vec &l, const cidx_t *idx, size_t n,
+const std::vector<size_t> &/* part */) {
+    Q.U.sync();
+    const arma::uword *cp = Q.U.col_ptrs, *ri = Q.U.row_indices;
+    const eT *v = Q.U.values;
+    const double *pd = d.memptr();
+    double *pl = l.memptr(), dl = 0;
+    for (size_t a = 0; a < n; a++) pl[idx[a]] = 0;
+    for (size_t a = 0; a < n; a++) {
+        cidx_t j = idx[a];
+        double dj = pd[j], aj = alpha * dj, s = 0, djj = 0;
+        for (arma::uword k = cp[j]; k < cp[j + 1]; k++) {
+            arma::uword r = ri[k];
+            if (r == j) { djj = v[k]; continue; }
+            s += v[k] * pd[r];
+            pl[r] += v[k] * aj;
+        }
+        pl[j] += alpha * s + djj * aj;
+        dl += dj * (2 * s + djj * dj);
+    }
+    return alpha * dl;
+}
+
+// Splits the chunks of a SELL-C-sigma matrix (same number of entries
+// per range, padding included).
+template<typename eT>
+void split(const sellmat_t<eT> &Q, const cidx_t *idx, size_t n, size_t np,
+std::vector<size_t> &part) {
+    if (idx) {
+        split_cost(idx, n, np, part,
+        [&](cidx_t i) { return Q.width(Q.pos[i] / SELL_C); });
+        return;
+    }
+    const size_t *cp = Q.cptr.data();
+    part.resize(np + 1);
+    part[0] = 0;
+    for (size_t t = 1; t < np; t++) {
+        size_t target = (Q.cptr.back() * t) / np;
+        part[t] = std::lower_bound(cp, cp + Q.n_chunks(), target) - cp;
+    }
+    part[np] = Q.n_chunks();
+}
+
+// Splits the block rows of a BCSR matrix (same number of blocks per range).
+template<typename eT>
+void split(const bcsrmat_t<eT> &Q, const cidx_t *idx, size_t n, size_t np,
+std::vector<size_t> &part) {
+    const size_t *bp = Q.bptr.data(), nb = Q.bptr.size() - 1;
+    if (idx) {
+        split_cost(idx, n, np, part,
+        [&](cidx_t i) { return bp[i / BCSR_R + 1] - bp[i / BCSR_R]; });
+        return;
+    }
+    part.resize(np + 1);
+    part[0] = 0;
+    for (size_t t = 1; t < np; t++) {
+        size_t target = (Q.bptr.back() * t) / np;
+        part[t] = std::lower_bound(bp, bp + nb, target) - bp;
+    }
+    part[np] = nb;
+}
+
+// Computes l = alpha * Q * d and returns d^T * l (SELL-C-sigma version).
+template<typename eT>
+double mul_dot(const sellmat_t<eT> &Q, double alpha, const arma::vec &d,
+arma::vec &l, const std::vector<size_t> &part) {
+    const double *pd = d.memptr();
+    double *pl = l.memptr(), dl = 0;
+    int np = (int) part.size() - 1;
+    #pragma omp parallel for num_threads(np) schedule(static, 1) \
+    reduction(+:dl)
+    for (int t = 0; t < np; t++) {
+        for (size_t k = part[t]; k < part[t + 1]; k++) {
+            double r[SELL_C];
+            size_t p = Q.cptr[k];
+            vsell8(Q.val.memptr() + p, Q.col.data() + p, Q.width(k), pd, r);
+            for (size_t s = 0; s < SELL_C; s++) {
+                cidx_t i = Q.perm[k * SELL_C + s];
+                if (i >= Q.n_rows) continue;
+                pl[i] = alpha * r[s];
+                dl += pd[i] * pl[i];
+            }
+        }
+    }
+    return dl;
+}
+
+// Computes l = alpha * Q * d and returns d^T * l (BCSR version).
+template<typename eT>
+double mul_dot(const bcsrmat_t<eT> &Q, double alpha, const arma::vec &d,
+arma::vec &l, const std::vector<size_t> &part) {
+    const double *pd = d.memptr();
+    double *pl = l.memptr(), dl = 0;
+    int np = (int) part.size() - 1;
+    #pragma omp parallel for num_threads(np) schedule(static, 1) \
+    reduction(+:dl)
+    for (int t = 0; t < np; t++) {
+        for (size_t br = part[t]; br < part[t + 1]; br++) {
+            double r[BCSR_R];
+            size_t b = Q.bptr[br];
+            vbcsr4(Q.val.memptr() + b * BCSR_R, Q.col.data() + b,
+            Q.bptr[br + 1] - b, pd, r);
+            size_t hi = std::min((br + 1) * BCSR_R, (size_t) Q.n_rows);
+            for (size_t i = br * BCSR_R; i < hi; i++) {
+                pl[i] = alpha * r[i - br * BCSR_R];
+                dl += pd[i] * pl[i];
+            }
+        }
+    }
+    return dl;
+}
+
+// Computes l = alpha * Q * d on the support of d and returns d^T * l
+// (SELL-C-sigma version). Each row is read from its lane of the chunk.
+template<typename eT>
+double mul_dot(const sellmat_t<eT> &Q, double alpha, const arma::vec &d,
+arma::vec &l, const cidx_t *idx, size_t /* n */,
+const std::vector<size_t> &part) {
+    const double *pd = d.memptr();
+    double *pl = l.memptr(), dl = 0;
+    int np = (int) part.size() - 1;
+    #pragma omp parallel for num_threads(np) schedule(static, 1) \
+    reduction(+:dl)
+    for (int t = 0; t < np; t++) {
+        for (size_t a = part[t]; a < part[t + 1]; a++) {
+            cidx_t i = idx[a];
+            size_t k = Q.pos[i] / SELL_C, w = Q.width(k);
+            size_t p = Q.cptr[k] + Q.pos[i] % SELL_C;
+            double s = 0;
+            for (size_t j = 0; j < w; j++, p += SELL_C) {
+                s += Q.val[p] * pd[Q.col[p]];
+            }
+            pl[i] = alpha * s;
+            dl += pd[i] * pl[i];
+        }
+    }
+    return dl;
+}
+
+// Computes l = alpha * Q * d on the support of d and returns d^T * l
+// (BCSR version). Each row is read from its lane of the blocks.
+template<typename eT>
+double mul_dot(const bcsrmat_t<eT> &Q, double alpha, const arma::vec &d,
+arma::vec &l, const cidx_t *idx, size_t /* n */,
+const std::vector<size_t> &part) {
+    const double *pd = d.memptr();
+    double *pl = l.memptr(), dl = 0;
+    int np = (int) part.size() - 1;
+    #pragma omp parallel for num_threads(np) schedule(static, 1) \
+    reduction(+:dl)
+    for (int t = 0; t < np; t++) {
+        for (size_t a = part[t]; a < part[t + 1]; a++) {
+            cidx_t i = idx[a];
+            size_t br = i / BCSR_R;
+            const eT *v = Q.val.memptr() + i % BCSR_R;
+            double s = 0;
+            for (size_t b = Q.bptr[br]; b < Q.bptr[br + 1]; b++) {
+                s += v[b * BCSR_R] * pd[Q.col[b]];
+            }
+            pl[i] = alpha * s;
+            dl += pd[i] * pl[i];
+        }
+    }
+    return dl;
+}
+
+// Splits the work of an automatic-format matrix.
+template<typename eT>
+void split(const spauto_t<eT> &Q, const cidx_t *idx, size_t n, size_t np,
+std::vector<size_t> &part) {
+    switch (Q.format) {
+        case SP_SELL: split(Q.sell, idx, n, np, part); break;
+        case SP_BCSR: split(Q.bcsr, idx, n, np, part); break;
+        default: split(Q.S, idx, n, np, part); break;
+    }
+}
+
+// Computes y = alpha * Q * v (automatic-format version).
+template<typename eT>
+void mul(const spauto_t<eT> &Q, double alpha, const arma::vec &v, arma::vec &y,
+const std::vector<size_t> &part) {
+    switch (Q.format) {
+        case SP_SELL: mul_dot(Q.sell, alpha, v, y, part); break;
+        case SP_BCSR: mul_dot(Q.bcsr, alpha, v, y, part); break;
+        default: mul(Q.S, alpha, v, y, part); break;
+    }
+}
+
+// Computes l = alpha * Q * d and returns d^T * l (automatic-format version).
+template<typename eT>
+double mul_dot(const spauto_t<eT> &Q, double alpha, const arma::vec &d,
+arma::vec &l, const std::vector<size_t> &part) {
+    switch (Q.format) {
+        case SP_SELL: return mul_dot(Q.sell, alpha, d, l, part);
+        case SP_BCSR: return mul_dot(Q.bcsr, alpha, d, l, part);
+        default: return mul_dot(Q.S, alpha, d, l, part);
+    }
+}
+
+// Computes l = alpha * Q * d on the support of d and returns d^T * l
+// (automatic-format version).
+template<typename eT>
+double mul_dot(const spauto_t<eT> &Q, double alpha, const arma::vec &d,
+arma::vec &l, const cidx_t *idx, size_t n, const std::vector<size_t> &part) {
+    switch (Q.format) {
+        case SP_SELL: return mul_dot(Q.sell, alpha, d, l, idx, n, part);
+        case SP_BCSR: return mul_dot(Q.bcsr, alpha, d, l, idx, n, part);
+        default: return mul_dot(Q.S, alpha, d, l, idx, n, part);
+    }
+}
+
+// Performs x = x + alpha * d and g = g + alpha * l in a single pass
+// over the listed coordinates.
+inline void update(double alpha, const cidx_t *idx, size_t lo, size_t n,
+const arma::vec &d, const arma::vec &l, arma::vec &x, arma::vec &g) {
+    vupdate(idx, lo, n, alpha, d.memptr(), l.memptr(), x.memptr(),
+        g.memptr());
+}
+
+#endif
@@ -0,0 +1,202 @@
+/*
+    File:       Kernels.hpp
+    Authors:    Matteo Loporchio, Davide Rucci
+
+    Computational Mathematics for Learning and Data Analysis 2018/2019
+*/
+
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#define ARMA_DONT_USE_WRAPPER
+#include <armadillo>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include "Config.hpp"
+#include "Simd.hpp"
+#include "SpFormats.hpp"
+#include "SymMatrix.hpp"
+
+/*
+    The buffers of the operators and of the solver are sized with fit(),
+    which only allocates when the size changes and counts the allocations
+    in buffer_allocs, so that the solver can report the ones made during
+    its iterations (see QResult).
+*/
+inline std::atomic<unsigned long> buffer_allocs{0};
+
+// Sets the size of b to rows x cols.
+template<typename eT>
+inline void fit(arma::Mat<eT> &b, arma::uword rows, arma::uword cols = 1) {
+    if (b.n_rows == rows && b.n_cols == cols) return;
+    if (b.n_elem != rows * cols) buffer_allocs++;
+    b.set_size(rows, cols);
+}
+
+// Sets the size of b to n (the capacity is never reduced).
+template<typename T>
+inline void fit(std::vector<T> &b, size_t n) {
+    if (n > b.capacity()) buffer_allocs++;
+    b.resize(n);
+}
+
+/*
+    The following functions split the columns of Q listed in idx (all the
+    columns if idx is null) into np ranges with about the same amount of
+    work, so that each range can be assigned to a different thread:
+    for a dense matrix each range gets the same number of columns, while
+    for a sparse matrix each range gets the same number of nonzeros.
+    Range t is made of the positions [part[t], part[t + 1]) of idx
+    (or of the columns, if idx is null).
+*/
+template<typename eT>
+void split(const arma::Mat<eT> &Q, const cidx_t *idx, size_t n, size_t np,
+std::vector<size_t> &part);
+
+template<typename eT>
+void split(const arma::SpMat<eT> &Q, const cidx_t *idx, size_t n, size_t np,
+std::vector<size_t> &part);
+
+/*
+    The following kernels compute y = alpha * Q * v without building any
+    temporary. In particular, the sparse version works directly on the
+    CSC arrays of Q, while an expression like 2 * Q * v would make
+    Armadillo materialize the scaled matrix 2 * Q first.
+    All the kernels of this file process the ranges of part in parallel.
+    Since Q is symmetric, the i-th row of Q is read as its i-th column:
+    each thread computes its own components of the result as dot products
+    over contiguous columns, so no scatter conflict can arise and no
+    transposed copy of Q is needed.
+    The kernels do not check the size of Q: QProblem checks once, when the
+    problem is built, that Q is n x n for n variables.
+*/
+template<typename eT>
+void mul(const arma::Mat<eT> &Q, double alpha, const arma::vec &v, arma::vec &y,
+const std::vector<size_t> &part);
+
+template<typename eT>
+void mul(const arma::SpMat<eT> &Q, double alpha, const arma::vec &v,
+arma::vec &y, const std::vector<size_t> &part);
+
+// The following kernels compute l = alpha * Q * d and return the
+// curvature term d^T * l in the same sweep over Q.
+template<typename eT>
+double mul_dot(const arma::Mat<eT> &Q, double alpha, const arma::vec &d,
+arma::vec &l, const std::vector<size_t> &part);
+
+template<typename eT>
+double mul_dot(const arma::SpMat<eT> &Q, double alpha, const arma::vec &d,
+arma::vec &l, const std::vector<size_t> &part);
+
+/*
+    The following kernels are the same as above, but assume that d is zero
+    outside the n coordinates listed in idx, and only compute l on those
+    coordinates. Only the columns of Q in the support of d are read:
+    the dense version also reads just the rows of the support, while the
+    sparse one reads the whole columns.
+*/
+template<typename eT>
+double mul_dot(const arma::Mat<eT> &Q, double alpha, const arma::vec &d,
+arma::vec &l, const cidx_t *idx, size_t n, const std::vector<size_t> &part);
+
+template<typename eT>
+double mul_dot(const arma::SpMat<eT> &Q, double alpha, const arma::vec &d,
+arma::vec &l, const cidx_t *idx, size_t n, const std::vector<size_t> &part);
+
+/*
+    The following kernels work on the symmetric formats of SymMatrix.hpp.
+    Each entry of the upper triangle is read once and applied twice,
+    to its row and to its column, so that only half of Q is streamed from
+    memory. Since the result is scattered, these kernels run on a single
+    thread: split() always returns a single range for them.
+*/
+template<typename eT>
+void split(const symmat_t<eT> &Q, const cidx_t *idx, size_t n, size_t np,
+std::vector<size_t> &part);
+
+template<typename eT>
+void split(const spsymmat_t<eT> &Q, const cidx_t *idx, size_t n, size_t np,
+std::vector<size_t> &part);
+
+template<typename eT>
+void mul(const symmat_t<eT> &Q, double alpha, const arma::vec &v, arma::vec &y,
+const std::vector<size_t> &part);
+
+template<typename eT>
+void mul(const spsymmat_t<eT> &Q, double alpha, const arma::vec &v, arma::vec &y,
+const std::vector<size_t> &part);
+
+template<typename eT>
+double mul_dot(const symmat_t<eT> &Q, double alpha, const arma::vec &d,
+arma::vec &l, const std::vector<size_t> &part);
+
+template<typename eT>
+double mul_dot(const spsymmat_t<eT> &Q, double alpha, const arma::vec &d,
+arma::vec &l, const std::vector<size_t> &part);
+
+template<typename eT>
+double mul_dot(const symmat_t<eT> &Q, double alpha, const arma::vec &d,
+arma::vec &l, const cidx_t *idx, size_t n, const std::vector<size_t> &part);
+
+template<typename eT>
+double mul_dot(const spsymmat_t<eT> &Q, double alpha, const arma::vec &d,
+arma::vec &l, const cidx_t *idx, size_t n, const std::vector<size_t> &part);
+
+/*
+    The following kernels work on the row formats of SpFormats.hpp.
+    Without idx, the ranges of part are made of chunks (SELL-C-sigma) or
+    of block rows (BCSR), which produce disjoint sets of components of the
+    result. With idx, each component is computed from its own row.
+*/
+template<typename eT>
+void split(const sellmat_t<eT> &Q, const cidx_t *idx, size_t n, size_t np,
+std::vector<size_t> &part);
+
+template<typename eT>
+void split(const bcsrmat_t<eT> &Q, const cidx_t *idx, size_t n, size_t np,
+std::vector<size_t> &part);
+
+template<typename eT>
+double mul_dot(const sellmat_t<eT> &Q, double alpha, const arma::vec &d,
+arma::vec &l, const std::vector<size_t> &part);
+
+template<typename eT>
+double mul_dot(const bcsrmat_t<eT> &Q, double alpha, const arma::vec &d,
+arma::vec &l, const std::vector<size_t> &part);
+
+template<typename eT>
+double mul_dot(const sellmat_t<eT> &Q, double alpha, const arma::vec &d,
+arma::vec &l, const cidx_t *idx, size_t n, const std::vector<size_t> &part);
+
+template<typename eT>
+double mul_dot(const bcsrmat_t<eT> &Q, double alpha, const arma::vec &d,
+arma::vec &l, const cidx_t *idx, size_t n, const std::vector<size_t> &part);
+
+// The following kernels forward to those of the format chosen by spauto_t.
+template<typename eT>
+void split(const spauto_t<eT> &Q, const cidx_t *idx, size_t n, size_t np,
+std::vector<size_t> &part);
+
+template<typename eT>
+void mul(const spauto_t<eT> &Q, double alpha, const arma::vec &v, arma::vec &y,
+const std::vector<size_t> &part);
+
+template<typename eT>
+double mul_dot(const spauto_t<eT> &Q, double alpha, const arma::vec &d,
+arma::vec &l, const std::vector<size_t> &part);
+
+template<typename eT>
+double mul_dot(const spauto_t<eT> &Q, double alpha, const arma::vec &d,
+arma::vec &l, const cidx_t *idx, size_t n, const std::vector<size_t> &part);
+
+// Performs x = x + alpha * d and g = g + alpha * l in a single pass
+// over the n coordinates listed in idx (or over [lo, lo + n) if idx
+// is null).
+void update(double alpha, const cidx_t *idx, size_t lo, size_t n,
+const arma::vec &d, const arma::vec &l, arma::vec &x, arma::vec &g);
+
+// The actual implementation is defined in the file Kernels.cpp.
+#include "Kernels.cpp"
+
+#endif
@@ -0,0 +1,101 @@
+/*
+    File:       LowRank.cpp
+    Authors:    Matteo Loporchio, Davide Rucci
+
+    Computational Mathematics for Learning and Data Analysis 2018/2019
+*/
+
+#ifndef LOWRANK_IMPL_
+#define LOWRANK_IMPL_
+
+#include "LowRank.hpp"
+
+// Splits the variables in np ranges of the same size.
+template<typename eT>
+void split(const lowrank_t<eT> &Q, const cidx_t *idx, size_t n, size_t np,
+std::vector<size_t> &part) {
+    split_even((idx) ? n : Q.n_cols, np, part);
+}
+
+/*
+    Computes y = alpha * (D * v + V * (V^T * v)) on the variables listed in
+    idx (all of them if idx is null) and returns v^T * y. The product
+    w = V^T * v is accumulated by each thread on its own range (in the
+    buffer acc, which is only allocated once) and then summed, so that
+    each component of y is a dot product with w.
+*/
+template<typename eT>
+double lowrank_apply(const lowrank_t<eT> &Q, double alpha, const arma::vec &v,
+arma::vec &y, const cidx_t *idx, const std::vector<size_t> &part) {
+    const size_t r = Q.Vt.n_rows;
+    const double *pv = v.memptr();
+    double *py = y.memptr(), dy = 0;
+    int np = (int) part.size() - 1;
+    fit(Q.acc, r, np);
+    Q.acc.zeros();
+    #pragma omp parallel for num_threads(np) schedule(static, 1)
+    for (int t = 0; t < np; t++) {
+        double *wt = Q.acc.colptr(t);
+        for (size_t a = part[t]; a < part[t + 1]; a++) {
+            size_t i = (idx) ? idx[a] : a;
+            if (pv[i] == 0) continue;
+            const eT *vi = Q.Vt.colptr(i);
+            for (size_t k = 0; k < r; k++) wt[k] += vi[k] * pv[i];
+        }
+    }
+    fit(Q.w, r);
+    Q.w.zeros();
+    for (int t = 0; t < np; t++) {
+        for (size_t k = 0; k < r; k++) Q.w(k) += Q.acc(k, t);
+    }
+    const double *pw = Q.w.memptr();
+    #pragma omp parallel for num_threads(np) schedule(static, 1) \
+    reduction(+:dy)
+    for (int t = 0; t < np; t++) {
+        for (size_t a = part[t]; a < part[t + 1]; a++) {
+            size_t i = (idx) ? idx[a] : a;
+            py[i] = alpha * (Q.D(i) * pv[i] + vdot(Q.Vt.colptr(i), pw, r));
+            dy += pv[i] * py[i];
+        }
+    }
+    return dy;
+}
+
+// Computes y = alpha * Q * v.
+template<typename eT>
+void mul(const lowrank_t<eT> &Q, double alpha, const arma::vec &v,
+arma::vec &y, const std::vector<size_t> &part) {
+    lowrank_apply(Q, alpha, v, y, nullptr, part);
+}
+
+// Computes l = alpha * Q * d and returns d^T * l.
+template<typename eT>
+double mul_dot(const lowrank_t<eT> &Q, double alpha, const arma::vec &d,
+arma::vec &l, const std::vector<size_t> &part) {
+    return lowrank_apply(Q, alpha, d, l, nullptr, part);
+}
+
+// Computes l = alpha * Q * d on the support of d and returns d^T * l.
+// Only the rows of V in the support are read, in O(n * r) time.
+template<typename eT>
+double mul_dot(const lowrank_t<eT> &Q, double alpha, const arma::vec &d,
+arma::vec &l, const cidx_t *idx, size_t /* n */,
+const std::vector<size_t> &part) {
+    return lowrank_apply(Q, alpha, d, l, idx, part);
+}
+
+// Applies the symmetric permutation Q = Q(p, p), which permutes
+// the diagonal and the rows of V.
+template<typename eT>
+void permute(lowrank_t<eT> &Q, const arma::uvec &p) {
+    Q.D = Q.D.elem(p);
+    Q.Vt = Q.Vt.cols(p);
+}
+
+// Low-rank matrices are dense, so they have no pattern.
+template<typename eT>
+bool pattern(const lowrank_t<eT> &, arma::uvec &, arma::uvec &) {
+    return false;
+}
+
+#endif
@@ -0,0 +1,82 @@
+/*
+    File:       LowRank.hpp
+    Authors:    Matteo Loporchio, Davide Rucci
+
+    Computational Mathematics for Learning and Data Analysis 2018/2019
+*/
+
+#ifndef LOWRANK_H
+#define LOWRANK_H
+
+#define ARMA_DONT_USE_WRAPPER
+#include <armadillo>
+#include <vector>
+#include "Kernels.hpp"
+
+/*
+    Hessian in diagonal-plus-low-rank form Q = D + V * V^T, where D is
+    diagonal and V is a dense n x r matrix with r << n, as in the covariance
+    matrices of factor models. A product with Q is computed as
+    D * d + V * (V^T * d), which takes O(n * r) time and memory instead
+    of O(n^2). V is stored by rows (as its transpose), so that the r
+    entries of each variable are contiguous.
+*/
+template<typename eT>
+struct lowrank_t {
+    typedef eT elem_type;
+
+    arma::uword n_rows = 0;     // Number of rows.
+    arma::uword n_cols = 0;     // Number of columns.
+    arma::Col<eT> D;            // Diagonal part.
+    arma::Mat<eT> Vt;           // Transpose of the factor (r x n).
+    mutable arma::vec w;        // Buffer for the product V^T * d.
+    mutable arma::mat acc;      // Partial sums of V^T * d of each thread.
+
+    lowrank_t() {}
+    lowrank_t(arma::Col<eT> D, arma::Mat<eT> V) {
+        set(std::move(D), std::move(V));
+    }
+
+    // Sets the diagonal part and the factor of Q (moved into the struct:
+    // V is transposed in place).
+    void set(arma::Col<eT> D, arma::Mat<eT> V) {
+        n_rows = n_cols = V.n_rows;
+        this->D = std::move(D);
+        arma::inplace_trans(V);
+        Vt = std::move(V);
+    }
+};
+
+/*
+    The following functions implement the Hessian operator concept
+    (see Operator.hpp) for a diagonal-plus-low-rank Q. Each range of part
+    gets the same number of variables. The products restricted to the
+    support of d only read the rows of V in the support.
+    These matrices are not reordered by RCM, since Q is dense.
+*/
+template<typename eT>
+void split(const lowrank_t<eT> &Q, const cidx_t *idx, size_t n, size_t np,
+std::vector<size_t> &part);
+
+template<typename eT>
+void mul(const lowrank_t<eT> &Q, double alpha, const arma::vec &v,
+arma::vec &y, const std::vector<size_t> &part);
+
+template<typename eT>
+double mul_dot(const lowrank_t<eT> &Q, double alpha, const arma::vec &d,
+arma::vec &l, const std::vector<size_t> &part);
+
+template<typename eT>
+double mul_dot(const lowrank_t<eT> &Q, double alpha, const arma::vec &d,
+arma::vec &l, const cidx_t *idx, size_t n, const std::vector<size_t> &part);
+
+template<typename eT>
+void permute(lowrank_t<eT> &Q, const arma::uvec &p);
+
+template<typename eT>
+bool pattern(const lowrank_t<eT> &Q, arma::uvec &cp, arma::uvec &ri);
+
+// The actual implementation is defined in the file LowRank.cpp.
+#include "LowRank.cpp"
+
+#endif
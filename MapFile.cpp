@@ -0,0 +1,109 @@
+/*
+    File:       MapFile.cpp
+    Authors:    Matteo Loporchio, Davide Rucci
+
+    Computational Mathematics for Learning and Data Analysis 2018/2019
+*/
+
+#include <cstdint>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "MapFile.hpp"
+
+// Maps the file at the given path in memory (read only).
+mapping_t map_file(const std::string &path, bool writable) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("Cannot open file: " + path);
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        throw std::runtime_error("Cannot read the size of file: " + path);
+    }
+    mapping_t m;
+    m.size = (size_t) st.st_size;
+    if (m.size == 0) {
+        close(fd);
+        return m;
+    }
+    void *p = (writable) ?
+    mmap(nullptr, m.size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0) :
+    mmap(nullptr, m.size, PROT_READ, MAP_SHARED, fd, 0);
+    // The mapping stays valid after the file is closed.
+    close(fd);
+    if (p == MAP_FAILED) throw std::runtime_error("Cannot map file: " + path);
+    madvise(p, m.size, MADV_SEQUENTIAL);
+    size_t size = m.size;
+    m.data = std::shared_ptr<const char>((const char *) p,
+        [size](const char *q) { munmap((void *) q, size); });
+    return m;
+}
+
+// Releases the pages that lie entirely within [p, p + len).
+void map_release(const void *p, size_t len) {
+    static const size_t page = (size_t) sysconf(_SC_PAGESIZE);
+    uintptr_t lo = ((uintptr_t) p + page - 1) & ~(uintptr_t) (page - 1);
+    uintptr_t hi = ((uintptr_t) p + len) & ~(uintptr_t) (page - 1);
+    if (lo < hi) madvise((void *) lo, hi - lo, MADV_DONTNEED);
+}
+
+// Starts reading the pages of [p, p + len) and touches one byte per page,
+// so that they are in memory when the range is used.
+void map_prefetch(const void *p, size_t len) {
+    if (len == 0) return;
+    static const size_t page = (size_t) sysconf(_SC_PAGESIZE);
+    uintptr_t lo = (uintptr_t) p & ~(uintptr_t) (page - 1);
+    uintptr_t hi = (uintptr_t) p + len;
+    madvise((void *) lo, hi - lo, MADV_WILLNEED);
+    volatile char sink = 0;
+    for (uintptr_t a = lo; a < hi; a += page) sink += *(const char *) a;
+    (void) sink;
+}
+
+// Starts the thread of the prefetcher.
+prefetcher_t::prefetcher_t() : worker(&prefetcher_t::run, this) {}
+
+// Stops the thread once the queued ranges have been served.
+prefetcher_t::~prefetcher_t() {
+    {
+        std::lock_guard<std::mutex> lock(m);
+        stop = true;
+    }
+    cv.notify_all();
+    worker.join();
+}
+
+// Queues a range and wakes up the thread.
+void prefetcher_t::post(const void *p, size_t len) {
+    {
+        std::lock_guard<std::mutex> lock(m);
+        queue.emplace_back(p, len);
+        posted++;
+    }
+    cv.notify_all();
+}
+
+// Waits until the thread has served all the queued ranges.
+void prefetcher_t::wait() {
+    std::unique_lock<std::mutex> lock(m);
+    cv.wait(lock, [this] { return done == posted; });
+}
+
+// Takes all the pending ranges at once and reads them outside of the lock.
+// The two queues are swapped, so that their memory is reused.
+void prefetcher_t::run() {
+    std::unique_lock<std::mutex> lock(m);
+    while (true) {
+        cv.wait(lock, [this] { return stop || !queue.empty(); });
+        if (queue.empty()) return;
+        batch.swap(queue);
+        lock.unlock();
+        for (const auto &r : batch) map_prefetch(r.first, r.second);
+        lock.lock();
+        done += batch.size();
+        batch.clear();
+        cv.notify_all();
+    }
+}
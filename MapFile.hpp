@@ -0,0 +1,73 @@
+/*
+    File:       MapFile.hpp
+    Authors:    Matteo Loporchio, Davide Rucci
+
+    Computational Mathematics for Learning and Data Analysis 2018/2019
+*/
+
+#ifndef MAPFILE_H
+#define MAPFILE_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Read-only memory mapping of a file. The mapping is shared by the copies
+// of the struct and released with the last one.
+struct mapping_t {
+    std::shared_ptr<const char> data;   // First byte of the file.
+    size_t size = 0;                    // Size of the file in bytes.
+};
+
+// Maps the file at the given path in memory, read only or (if writable is
+// true) privately, so that the changes are never written to the file.
+// The pages are expected to be read sequentially.
+mapping_t map_file(const std::string &path, bool writable = false);
+
+// Starts reading the pages of the range [p, p + len) of a mapping and
+// waits until they are all in memory.
+void map_prefetch(const void *p, size_t len);
+
+// Releases the memory of the pages within [p, p + len) of a mapping that
+// are not needed anymore (they are read again from the file if used).
+void map_release(const void *p, size_t len);
+
+/*
+    Background reader of a mapping. A single thread, started with the
+    object and stopped by its destructor, serves the ranges queued by
+    post() with map_prefetch, so that the pages can be read while the
+    caller computes on the previous ones.
+*/
+class prefetcher_t {
+public:
+    prefetcher_t();
+    ~prefetcher_t();
+    prefetcher_t(const prefetcher_t &) = delete;
+    prefetcher_t &operator=(const prefetcher_t &) = delete;
+
+    // Queues the range [p, p + len) of a mapping.
+    void post(const void *p, size_t len);
+
+    // Waits until all the queued ranges are in memory.
+    void wait();
+
+private:
+    std::mutex m;
+    std::condition_variable cv;
+    std::vector<std::pair<const void *, size_t>> queue;    // Pending ranges.
+    std::vector<std::pair<const void *, size_t>> batch;    // Ranges served.
+    size_t posted = 0;      // Number of ranges queued so far.
+    size_t done = 0;        // Number of ranges served so far.
+    bool stop = false;      // True if the thread has to terminate.
+    std::thread worker;     // Thread that serves the ranges.
+
+    // Main loop of the thread.
+    void run();
+};
+
+#endif
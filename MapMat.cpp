@@ -0,0 +1,161 @@
+/*
+    File:       MapMat.cpp
+    Authors:    Matteo Loporchio, Davide Rucci
+
+    Computational Mathematics for Learning and Data Analysis 2018/2019
+*/
+
+#ifndef MAPMAT_IMPL_
+#define MAPMAT_IMPL_
+
+#include <algorithm>
+#include "MapMat.hpp"
+
+// Maps the file of an n x n matrix and checks its size.
+template<typename eT>
+void mapmat_t<eT>::open(const std::string &path, arma::uword n) {
+    map = map_file(path);
+    if (map.size != (size_t) n * n * sizeof(eT)) {
+        throw std::runtime_error("The size of file " + path + " does not "
+        "match a " + std::to_string(n) + " x " + std::to_string(n) +
+        " matrix.");
+    }
+    n_rows = n_cols = n;
+    p.reset();
+    if (!pf) pf = std::make_shared<prefetcher_t>();
+}
+
+// Returns the number of columns per tile.
+template<typename eT>
+size_t mapmat_t<eT>::tile() const {
+    size_t col_size = std::max<size_t>(n_rows * sizeof(eT), 1);
+    return std::max<size_t>((size_t) TILE_MB * 1024 * 1024 / col_size, 1);
+}
+
+// Maps an index of the permuted matrix to the file.
+template<typename eT>
+inline arma::uword map_index(const mapmat_t<eT> &Q, arma::uword i) {
+    return (Q.p.n_elem > 0) ? Q.p(i) : i;
+}
+
+// Splits the variables in np ranges of the same size.
+template<typename eT>
+void split(const mapmat_t<eT> &Q, const cidx_t *idx, size_t n, size_t np,
+std::vector<size_t> &part) {
+    split_even((idx) ? n : Q.n_cols, np, part);
+}
+
+/*
+    Computes y = alpha * Q(p, p) * v. The vector is scattered to the order
+    of the file, the tiles of columns are processed one after the other
+    (while the next one is read by the prefetcher) and the result is
+    gathered back.
+*/
+template<typename eT>
+void mul(const mapmat_t<eT> &Q, double alpha, const arma::vec &v,
+arma::vec &y, const std::vector<size_t> &part) {
+    bool perm = (Q.p.n_elem > 0);
+    if (perm) {
+        fit(Q.xb, Q.n_cols);
+        Q.xb.elem(Q.p) = v;
+        fit(Q.yb, Q.n_rows);
+    }
+    const double *px = (perm) ? Q.xb.memptr() : v.memptr();
+    double *py = (perm) ? Q.yb.memptr() : y.memptr();
+    // Non-owning view of the mapped entries (never written).
+    const arma::Mat<eT> A((eT *) Q.colptr(0), Q.n_rows, Q.n_cols, false, true);
+    int np = (int) part.size() - 1;
+    size_t n = Q.n_cols, ts = Q.tile();
+    for (size_t lo = 0; lo < n; lo += ts) {
+        size_t hi = std::min(n, lo + ts);
+        if (hi < n) {
+            Q.pf->post(Q.colptr(hi),
+            std::min(ts, n - hi) * Q.n_rows * sizeof(eT));
+        }
+        #pragma omp parallel for num_threads(np) schedule(static, 1)
+        for (int t = 0; t < np; t++) {
+            gemv(A, alpha, px, py, lo + ((hi - lo) * t) / np,
+            lo + ((hi - lo) * (t + 1)) / np);
+        }
+        if (hi < n) Q.pf->wait();
+    }
+    if (perm) y = Q.yb.elem(Q.p);
+}
+
+// Computes l = alpha * Q * d and returns d^T * l.
+template<typename eT>
+double mul_dot(const mapmat_t<eT> &Q, double alpha, const arma::vec &d,
+arma::vec &l, const std::vector<size_t> &part) {
+    mul(Q, alpha, d, l, part);
+    return arma::dot(d, l);
+}
+
+// Queues the columns of the positions ord[lo, hi) of the support.
+template<typename eT>
+void map_prefetch_cols(const mapmat_t<eT> &Q, size_t lo, size_t hi) {
+    for (size_t k = lo; k < hi; k++) {
+        Q.pf->post(Q.colptr(Q.rows[Q.ord[k]]), Q.n_rows * sizeof(eT));
+    }
+}
+
+/*
+    Computes l = alpha * Q * d on the support of d and returns d^T * l.
+    The columns of the support are read in the order of the file, in tiles
+    of the same size as the full product, and each component of l is a dot
+    product restricted to the support.
+*/
+template<typename eT>
+double mul_dot(const mapmat_t<eT> &Q, double alpha, const arma::vec &d,
+arma::vec &l, const cidx_t *idx, size_t n, const std::vector<size_t> &part) {
+    const double *pd = d.memptr();
+    double *pl = l.memptr(), dl = 0;
+    // Scatter the support of d to the order of the file.
+    fit(Q.xb, Q.n_cols);
+    fit(Q.rows, n);
+    fit(Q.ord, n);
+    for (size_t a = 0; a < n; a++) {
+        Q.rows[a] = (cidx_t) map_index(Q, idx[a]);
+        Q.xb(Q.rows[a]) = pd[idx[a]];
+        Q.ord[a] = a;
+    }
+    std::sort(Q.ord.begin(), Q.ord.end(),
+    [&Q](size_t a, size_t b) { return Q.rows[a] < Q.rows[b]; });
+    const double *px = Q.xb.memptr();
+    const cidx_t *rows = Q.rows.data();
+    int np = (int) part.size() - 1;
+    size_t ts = Q.tile();
+    for (size_t lo = 0; lo < n; lo += ts) {
+        size_t hi = std::min(n, lo + ts);
+        if (hi < n) map_prefetch_cols(Q, hi, std::min(n, hi + ts));
+        #pragma omp parallel for num_threads(np) schedule(static, 1) \
+        reduction(+:dl)
+        for (int t = 0; t < np; t++) {
+            size_t a0 = lo + ((hi - lo) * t) / np;
+            size_t a1 = lo + ((hi - lo) * (t + 1)) / np;
+            for (size_t k = a0; k < a1; k++) {
+                size_t a = Q.ord[k];
+                cidx_t i = idx[a];
+                pl[i] = alpha * vdot_idx(Q.colptr(rows[a]), px, rows, n);
+                dl += pd[i] * pl[i];
+            }
+        }
+        if (hi < n) Q.pf->wait();
+    }
+    return dl;
+}
+
+// Applies the symmetric permutation Q = Q(p, p) by composing it with
+// the permutation already applied.
+template<typename eT>
+void permute(mapmat_t<eT> &Q, const arma::uvec &p) {
+    if (Q.p.n_elem > 0) Q.p = Q.p.elem(p);
+    else Q.p = p;
+}
+
+// Mapped matrices are dense, so they have no pattern.
+template<typename eT>
+bool pattern(const mapmat_t<eT> &, arma::uvec &, arma::uvec &) {
+    return false;
+}
+
+#endif
@@ -0,0 +1,91 @@
+/*
+    File:       MapMat.hpp
+    Authors:    Matteo Loporchio, Davide Rucci
+
+    Computational Mathematics for Learning and Data Analysis 2018/2019
+*/
+
+#ifndef MAPMAT_H
+#define MAPMAT_H
+
+#define ARMA_DONT_USE_WRAPPER
+#include <armadillo>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Config.hpp"
+#include "Kernels.hpp"
+#include "MapFile.hpp"
+
+/*
+    Out-of-core dense Hessian, memory-mapped from a binary file that holds
+    the n x n entries of Q in column-major order. Only the pages being used
+    are kept in memory, so n is not limited by the available RAM.
+    The products read Q in tiles of TILE_MB megabytes: while a tile is
+    processed by the OpenMP threads, the prefetcher of the matrix (one
+    thread that lives as long as the mapping) reads the next one from the
+    disk, so that reading and computing overlap.
+    Since the file is read-only, the permutation applied by the reordering
+    is kept aside and applied to the vectors at each product, as in op_t.
+*/
+template<typename eT>
+struct mapmat_t {
+    typedef eT elem_type;
+
+    arma::uword n_rows = 0;     // Number of rows.
+    arma::uword n_cols = 0;     // Number of columns.
+    mapping_t map;              // Mapping of the file.
+    std::shared_ptr<prefetcher_t> pf;       // Reader of the next tile.
+    arma::uvec p;               // Permutation Q(p, p) (empty if none).
+    mutable arma::vec xb, yb;   // Buffers for the permuted products.
+    mutable std::vector<cidx_t> rows;       // Support in the file order.
+    mutable std::vector<size_t> ord;        // Support sorted by column.
+
+    mapmat_t() {}
+    mapmat_t(const std::string &path, arma::uword n) { open(path, n); }
+
+    // Maps the file of an n x n matrix.
+    void open(const std::string &path, arma::uword n);
+
+    // Returns the j-th column of Q (in the file order).
+    const eT *colptr(arma::uword j) const {
+        return (const eT *) map.data.get() + (size_t) j * n_rows;
+    }
+
+    // Returns the number of columns per tile.
+    size_t tile() const;
+};
+
+/*
+    The following functions implement the Hessian operator concept
+    (see Operator.hpp) for an out-of-core Q. Each tile is split among the
+    threads with the same number of columns per range. The products
+    restricted to the support of d read its columns in the order of the
+    file. Mapped matrices are not reordered by RCM, since Q is dense.
+*/
+template<typename eT>
+void split(const mapmat_t<eT> &Q, const cidx_t *idx, size_t n, size_t np,
+std::vector<size_t> &part);
+
+template<typename eT>
+void mul(const mapmat_t<eT> &Q, double alpha, const arma::vec &v,
+arma::vec &y, const std::vector<size_t> &part);
+
+template<typename eT>
+double mul_dot(const mapmat_t<eT> &Q, double alpha, const arma::vec &d,
+arma::vec &l, const std::vector<size_t> &part);
+
+template<typename eT>
+double mul_dot(const mapmat_t<eT> &Q, double alpha, const arma::vec &d,
+arma::vec &l, const cidx_t *idx, size_t n, const std::vector<size_t> &part);
+
+template<typename eT>
+void permute(mapmat_t<eT> &Q, const arma::uvec &p);
+
+template<typename eT>
+bool pattern(const mapmat_t<eT> &Q, arma::uvec &cp, arma::uvec &ri);
+
+// The actual implementation is defined in the file MapMat.cpp.
+#include "MapMat.cpp"
+
+#endif
@@ -0,0 +1,119 @@
+/*
+    File:       Operator.cpp
+    Authors:    Matteo Loporchio, Davide Rucci
+
+    Computational Mathematics for Learning and Data Analysis 2018/2019
+*/
+
+#ifndef OPERATOR_IMPL_
+#define OPERATOR_IMPL_
+
+#include "Operator.hpp"
+
+// Maps an index of the permuted operator to the wrapped one.
+template<typename Op>
+inline arma::uword op_index(const op_t<Op> &Q, arma::uword i) {
+    return (Q.p.n_elem > 0) ? Q.p(i) : i;
+}
+
+// Computes y = alpha * Q(p, p) * v with the wrapped operator: v is
+// scattered to the original ordering and the result gathered back.
+template<typename Op>
+void op_apply(const op_t<Op> &Q, double alpha, const arma::vec &v,
+arma::vec &y) {
+    bool perm = (Q.p.n_elem > 0);
+    if (perm) {
+        fit(Q.xb, Q.n_cols);
+        Q.xb.elem(Q.p) = v;
+        fit(Q.yb, Q.n_rows);
+    }
+    const arma::vec &x = (perm) ? Q.xb : v;
+    arma::vec &r = (perm) ? Q.yb : y;
+    if constexpr (has_scaled_apply<Op>::value) Q.op.apply(alpha, x, r);
+    else {
+        Q.op.apply(x, r);
+        if (alpha != 1) r *= alpha;
+    }
+    if (perm) y = Q.yb.elem(Q.p);
+}
+
+// Applies the symmetric permutation Q = Q(p, p) to a matrix-free operator
+// by composing it with the permutation already applied.
+template<typename Op>
+void permute(op_t<Op> &Q, const arma::uvec &p) {
+    if (Q.p.n_elem > 0) Q.p = Q.p.elem(p);
+    else Q.p = p;
+}
+
+// Matrix-free operators are processed as a single range.
+template<typename Op>
+void split(const op_t<Op> &Q, const cidx_t *idx, size_t n, size_t /* np */,
+std::vector<size_t> &part) {
+    split_even((idx) ? n : Q.n_cols, 1, part);
+}
+
+// Computes y = alpha * Q * v (matrix-free version).
+template<typename Op>
+void mul(const op_t<Op> &Q, double alpha, const arma::vec &v, arma::vec &y,
+const std::vector<size_t> &/* part */) {
+    op_apply(Q, alpha, v, y);
+}
+
+// Computes l = alpha * Q * d and returns d^T * l (matrix-free version).
+template<typename Op>
+double mul_dot(const op_t<Op> &Q, double alpha, const arma::vec &d,
+arma::vec &l, const std::vector<size_t> &/* part */) {
+    op_apply(Q, alpha, d, l);
+    return arma::dot(d, l);
+}
+
+// Computes l = alpha * Q * d on the support of d and returns d^T * l
+// (matrix-free version). Without column access, the full product is used.
+template<typename Op>
+double mul_dot(const op_t<Op> &Q, double alpha, const arma::vec &d,
+arma::vec &l, const cidx_t *idx, size_t n, const std::vector<size_t> &part) {
+    if constexpr (has_column<Op>::value) {
+        const double *pd = d.memptr();
+        double *pl = l.memptr(), dl = 0;
+        fit(Q.col, Q.n_rows);
+        double *col = Q.col.memptr();
+        for (size_t a = 0; a < n; a++) pl[idx[a]] = 0;
+        for (size_t a = 0; a < n; a++) {
+            cidx_t j = idx[a];
+            Q.op.column(op_index(Q, j), col);
+            double aj = alpha * pd[j];
+            for (size_t b = 0; b < n; b++) {
+                pl[idx[b]] += col[op_index(Q, idx[b])] * aj;
+            }
+        }
+        for (size_t a = 0; a < n; a++) dl += pd[idx[a]] * pl[idx[a]];
+        return dl;
+    }
+    else return mul_dot(Q, alpha, d, l, part);
+}
+
+// The pattern of a matrix-free operator is not known.
+template<typename Op>
+bool pattern(const op_t<Op> &, arma::uvec &, arma::uvec &) {
+    return false;
+}
+
+// Returns Q(i, i), from the diagonal or from the columns of the operator
+// (or from a product with the i-th unit vector if neither is available).
+template<typename Op>
+double diag(const op_t<Op> &Q, arma::uword i) {
+    if constexpr (has_diag<Op>::value) return Q.op.diag(op_index(Q, i));
+    else if constexpr (has_column<Op>::value) {
+        fit(Q.col, Q.n_rows);
+        Q.op.column(op_index(Q, i), Q.col.memptr());
+        return Q.col(op_index(Q, i));
+    }
+    else {
+        arma::vec e = arma::zeros(Q.n_cols), y(Q.n_rows);
+        e(i) = 1;
+        op_apply(Q, 1, e, y);
+        return y(i);
+    }
+}
+
+#endif
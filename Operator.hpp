@@ -0,0 +1,185 @@
+/*
+    File:       Operator.hpp
+    Authors:    Matteo Loporchio, Davide Rucci
+
+    Computational Mathematics for Learning and Data Analysis 2018/2019
+*/
+
+#ifndef OPERATOR_H
+#define OPERATOR_H
+
+#define ARMA_DONT_USE_WRAPPER
+#include <armadillo>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "Config.hpp"
+#include "Kernels.hpp"
+#include "Ordering.hpp"
+
+/*
+    Hessian operators.
+
+    QProblem<T> only accesses its Hessian Q (of size n x n) through the
+    following members and free functions, which make up the concept of
+    Hessian operator:
+
+        T::elem_type                    type of the stored entries (double
+                                        or float)
+        split(Q, idx, n, np, part)      splits the work of the products in
+                                        np ranges (see Kernels.hpp)
+        mul(Q, alpha, v, y, part)       computes y = alpha * Q * v
+        mul_dot(Q, alpha, d, l, part)   computes l = alpha * Q * d and
+                                        returns d^T * l
+        mul_dot(Q, alpha, d, l, idx, n, part)
+                                        same as above, on the support idx
+                                        of d
+        permute(Q, p)                   applies the permutation Q(p, p)
+        pattern(Q, cp, ri)              returns the sparsity pattern of Q
+                                        in CSC form, used by the RCM
+                                        ordering (false if Q is dense)
+
+    Kernels.hpp, Ordering.hpp and this file implement them for all the
+    matrix types of the solver, and is_hessian<T> checks them at compile
+    time.
+
+    A matrix-free operator only has to provide the products. Any class Op
+    with the members
+
+        arma::uword n_rows, n_cols;
+        void apply(const arma::vec &x, arma::vec &y) const;     // y = Q * x
+
+    can be plugged into QProblem as op_t<Op>, which implements the concept
+    on top of them. The following members are optional:
+
+        typedef ... elem_type;          // double if missing
+        void apply(double alpha, const arma::vec &x, arma::vec &y) const;
+                                        // y = alpha * Q * x
+        double diag(arma::uword i) const;                       // Q(i, i)
+        void column(arma::uword j, double *c) const;            // Q(:, j)
+
+    If column() is available, the products restricted to the support of
+    the direction are computed from the columns of the support instead of
+    a full product.
+*/
+
+// Detection of the optional members of a matrix-free operator.
+template<typename Op, typename = void>
+struct has_elem_type : std::false_type {};
+
+template<typename Op>
+struct has_elem_type<Op, std::void_t<typename Op::elem_type>>
+: std::true_type {};
+
+template<typename Op, typename = void>
+struct has_scaled_apply : std::false_type {};
+
+template<typename Op>
+struct has_scaled_apply<Op, std::void_t<decltype(std::declval<const Op &>()
+.apply(1.0, std::declval<const arma::vec &>(), std::declval<arma::vec &>()))>>
+: std::true_type {};
+
+template<typename Op, typename = void>
+struct has_diag : std::false_type {};
+
+template<typename Op>
+struct has_diag<Op, std::void_t<decltype(std::declval<const Op &>()
+.diag(arma::uword()))>> : std::true_type {};
+
+template<typename Op, typename = void>
+struct has_column : std::false_type {};
+
+template<typename Op>
+struct has_column<Op, std::void_t<decltype(std::declval<const Op &>()
+.column(arma::uword(), (double *) nullptr))>> : std::true_type {};
+
+// Type of the entries of a matrix-free operator.
+template<typename Op, bool = has_elem_type<Op>::value>
+struct op_elem { typedef double type; };
+
+template<typename Op>
+struct op_elem<Op, true> { typedef typename Op::elem_type type; };
+
+/*
+    Adapter of a matrix-free operator to the concept of Hessian operator.
+    Since a matrix-free operator cannot be permuted, the permutation
+    applied by the reordering is kept aside and applied to the vectors
+    at each product.
+*/
+template<typename Op>
+struct op_t {
+    typedef typename op_elem<Op>::type elem_type;
+
+    Op op;                      // Wrapped operator.
+    arma::uword n_rows = 0;     // Number of rows.
+    arma::uword n_cols = 0;     // Number of columns.
+    arma::uvec p;               // Permutation Q(p, p) (empty if none).
+    mutable arma::vec xb, yb;   // Buffers for the permuted products.
+    mutable arma::vec col;      // Buffer for a column of the operator.
+
+    op_t() {}
+    op_t(const Op &A) : op(A), n_rows(A.n_rows), n_cols(A.n_cols) {}
+    op_t(Op &&A) : op(std::move(A)), n_rows(op.n_rows), n_cols(op.n_cols) {}
+};
+
+// Applies the symmetric permutation Q = Q(p, p) in place.
+template<typename eT> void permute(arma::Mat<eT> &Q, const arma::uvec &p);
+template<typename eT> void permute(arma::SpMat<eT> &Q, const arma::uvec &p);
+template<typename eT> void permute(symmat_t<eT> &Q, const arma::uvec &p);
+template<typename eT> void permute(spsymmat_t<eT> &Q, const arma::uvec &p);
+template<typename eT> void permute(spauto_t<eT> &Q, const arma::uvec &p);
+template<typename Op> void permute(op_t<Op> &Q, const arma::uvec &p);
+
+// The following functions implement the concept for op_t: the products
+// run on a single range, since the operator manages its own parallelism.
+template<typename Op>
+void split(const op_t<Op> &Q, const cidx_t *idx, size_t n, size_t np,
+std::vector<size_t> &part);
+
+template<typename Op>
+void mul(const op_t<Op> &Q, double alpha, const arma::vec &v, arma::vec &y,
+const std::vector<size_t> &part);
+
+template<typename Op>
+double mul_dot(const op_t<Op> &Q, double alpha, const arma::vec &d,
+arma::vec &l, const std::vector<size_t> &part);
+
+template<typename Op>
+double mul_dot(const op_t<Op> &Q, double alpha, const arma::vec &d,
+arma::vec &l, const cidx_t *idx, size_t n, const std::vector<size_t> &part);
+
+template<typename Op>
+bool pattern(const op_t<Op> &Q, arma::uvec &cp, arma::uvec &ri);
+
+// Returns Q(i, i), from the diagonal or from the columns of the operator.
+template<typename Op>
+double diag(const op_t<Op> &Q, arma::uword i);
+
+// Checks at compile time that T is a Hessian operator.
+template<typename T, typename = void>
+struct is_hessian : std::false_type {};
+
+template<typename T>
+struct is_hessian<T, std::void_t<
+    typename T::elem_type,
+    decltype(split(std::declval<const T &>(), (const cidx_t *) nullptr,
+        size_t(), size_t(), std::declval<std::vector<size_t> &>())),
+    decltype(mul(std::declval<const T &>(), 1.0,
+        std::declval<const arma::vec &>(), std::declval<arma::vec &>(),
+        std::declval<const std::vector<size_t> &>())),
+    decltype(mul_dot(std::declval<const T &>(), 1.0,
+        std::declval<const arma::vec &>(), std::declval<arma::vec &>(),
+        std::declval<const std::vector<size_t> &>())),
+    decltype(mul_dot(std::declval<const T &>(), 1.0,
+        std::declval<const arma::vec &>(), std::declval<arma::vec &>(),
+        (const cidx_t *) nullptr, size_t(),
+        std::declval<const std::vector<size_t> &>())),
+    decltype(permute(std::declval<T &>(), std::declval<const arma::uvec &>())),
+    decltype(pattern(std::declval<const T &>(), std::declval<arma::uvec &>(),
+        std::declval<arma::uvec &>()))>>
+: std::true_type {};
+
+// The actual implementation is defined in the file Operator.cpp.
+#include "Operator.cpp"
+
+#endif
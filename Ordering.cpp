@@ -0,0 +1,154 @@
+/*
+    File:       Ordering.cpp
+    Authors:    Matteo Loporchio, Davide Rucci
+
+    Computational Mathematics for Learning and Data Analysis 2018/2019
+*/
+
+#ifndef ORDERING_IMPL_
+#define ORDERING_IMPL_
+
+#include <algorithm>
+#include <numeric>
+#include <utility>
+#include <vector>
+#include "Ordering.hpp"
+
+// Computes the reverse Cuthill-McKee ordering of a graph in CSC form.
+inline void rcm(arma::uword n, const arma::uword *cp, const arma::uword *ri,
+arma::uvec &rank) {
+    std::vector<arma::uword> deg(n), depth(n), stamp(n, 0), level, order;
+    std::vector<bool> done(n, false);
+    for (arma::uword i = 0; i < n; i++) deg[i] = cp[i + 1] - cp[i];
+    auto by_degree = [&](arma::uword a, arma::uword b) {
+        return (deg[a] != deg[b]) ? deg[a] < deg[b] : a < b;
+    };
+    // Breadth-first search from s: the vertices of its component are
+    // stored in level, in order of visit, together with their depth.
+    arma::uword cur = 0;
+    auto bfs = [&](arma::uword s) {
+        level.clear();
+        level.push_back(s);
+        stamp[s] = ++cur;
+        depth[s] = 0;
+        for (size_t h = 0; h < level.size(); h++) {
+            arma::uword u = level[h];
+            for (arma::uword k = cp[u]; k < cp[u + 1]; k++) {
+                arma::uword v = ri[k];
+                if (stamp[v] == cur) continue;
+                stamp[v] = cur;
+                depth[v] = depth[u] + 1;
+                level.push_back(v);
+            }
+        }
+    };
+    // Components are started from their vertices of smallest degree.
+    std::vector<arma::uword> start(n);
+    std::iota(start.begin(), start.end(), 0);
+    std::stable_sort(start.begin(), start.end(), by_degree);
+    order.reserve(n);
+    for (arma::uword s : start) {
+        if (done[s]) continue;
+        // Look for a pseudo-peripheral vertex: move to the vertex of
+        // smallest degree in the last level while the depth grows.
+        arma::uword ecc = 0;
+        for (int it = 0; it < 8; it++) {
+            bfs(s);
+            arma::uword e = depth[level.back()], best = level.back();
+            if (it > 0 && e <= ecc) break;
+            ecc = e;
+            for (size_t h = level.size(); h-- > 0 && depth[level[h]] == e;) {
+                if (by_degree(level[h], best)) best = level[h];
+            }
+            s = best;
+        }
+        // Cuthill-McKee visit: the unvisited neighbours of each vertex
+        // are appended by increasing degree.
+        size_t h = order.size();
+        order.push_back(s);
+        done[s] = true;
+        for (; h < order.size(); h++) {
+            arma::uword u = order[h];
+            size_t first = order.size();
+            for (arma::uword k = cp[u]; k < cp[u + 1]; k++) {
+                arma::uword v = ri[k];
+                if (done[v]) continue;
+                done[v] = true;
+                order.push_back(v);
+            }
+            std::sort(order.begin() + first, order.end(), by_degree);
+        }
+    }
+    rank.set_size(n);
+    for (arma::uword i = 0; i < n; i++) rank(order[n - 1 - i]) = i;
+}
+
+// Computes the RCM ranks of groups of vertices of a graph in CSC form.
+inline void rcm_groups(arma::uword n, const arma::uword *cp,
+const arma::uword *ri, const arma::uvec &group, arma::uword ng,
+arma::uvec &rank) {
+    std::vector<std::pair<arma::uword, arma::uword>> e;
+    for (arma::uword j = 0; j < n; j++) {
+        for (arma::uword k = cp[j]; k < cp[j + 1]; k++) {
+            if (group(ri[k]) != group(j)) e.push_back({group(j), group(ri[k])});
+        }
+    }
+    std::sort(e.begin(), e.end());
+    e.erase(std::unique(e.begin(), e.end()), e.end());
+    std::vector<arma::uword> gcp(ng + 1, 0), gri(e.size());
+    for (size_t k = 0; k < e.size(); k++) {
+        gcp[e[k].first + 1]++;
+        gri[k] = e[k].second;
+    }
+    std::partial_sum(gcp.begin(), gcp.end(), gcp.begin());
+    rcm(ng, gcp.data(), gri.data(), rank);
+}
+
+// Returns the mean distance from the diagonal of the entries of a graph.
+inline double mean_dist(arma::uword n, const arma::uword *cp,
+const arma::uword *ri, const arma::uvec &pos) {
+    double s = 0;
+    for (arma::uword j = 0; j < n; j++) {
+        for (arma::uword k = cp[j]; k < cp[j + 1]; k++) {
+            arma::uword a = pos(ri[k]), b = pos(j);
+            s += (a > b) ? a - b : b - a;
+        }
+    }
+    return (cp[n] > 0) ? s / cp[n] : 0;
+}
+
+// Dense matrices have no pattern.
+template<typename eT>
+bool pattern(const arma::Mat<eT> &, arma::uvec &, arma::uvec &) {
+    return false;
+}
+
+template<typename eT>
+bool pattern(const symmat_t<eT> &, arma::uvec &, arma::uvec &) {
+    return false;
+}
+
+// Pattern of a sparse matrix.
+template<typename eT>
+bool pattern(const arma::SpMat<eT> &Q, arma::uvec &cp, arma::uvec &ri) {
+    Q.sync();
+    cp = arma::uvec(Q.col_ptrs, Q.n_cols + 1);
+    ri = arma::uvec(Q.row_indices, Q.n_nonzero);
+    return true;
+}
+
+// Pattern of a sparse symmetric matrix: the upper triangle is mirrored.
+template<typename eT>
+bool pattern(const spsymmat_t<eT> &Q, arma::uvec &cp, arma::uvec &ri) {
+    arma::SpMat<eT> A = Q.U + Q.U.t();
+    return pattern(A, cp, ri);
+}
+
+// Pattern of a matrix in automatic format.
+template<typename eT>
+bool pattern(const spauto_t<eT> &Q, arma::uvec &cp, arma::uvec &ri) {
+    if (Q.format == SP_CSC) return pattern(Q.S, cp, ri);
+    return pattern(Q.to_spmat(), cp, ri);
+}
+
+#endif
@@ -0,0 +1,66 @@
+/*
+    File:       Ordering.hpp
+    Authors:    Matteo Loporchio, Davide Rucci
+
+    Computational Mathematics for Learning and Data Analysis 2018/2019
+*/
+
+#ifndef ORDERING_H
+#define ORDERING_H
+
+#define ARMA_DONT_USE_WRAPPER
+#include <armadillo>
+#include "SpFormats.hpp"
+#include "SymMatrix.hpp"
+
+/*
+    Computes the reverse Cuthill-McKee ordering of the undirected graph with
+    n vertices whose adjacency lists are stored in CSC form (cp, ri).
+    Each connected component is visited breadth-first from a
+    pseudo-peripheral vertex, taking the neighbours of each vertex by
+    increasing degree, and the resulting order is reversed: rank(i) is
+    the new position of vertex i. Adjacent vertices get close ranks, so the
+    bandwidth of the matrix is reduced.
+*/
+void rcm(arma::uword n, const arma::uword *cp, const arma::uword *ri,
+arma::uvec &rank);
+
+/*
+    Computes the RCM ranks of ng groups of vertices of the same graph,
+    where group(i) is the group of vertex i: two groups are adjacent if any
+    of their vertices are. This orders the blocks of the constraint list
+    when they are kept contiguous.
+*/
+void rcm_groups(arma::uword n, const arma::uword *cp, const arma::uword *ri,
+const arma::uvec &group, arma::uword ng, arma::uvec &rank);
+
+// Returns the mean distance |pos(i) - pos(j)| from the diagonal of the
+// entries (i, j) of a graph in CSC form, once each vertex i is moved to
+// position pos(i).
+double mean_dist(arma::uword n, const arma::uword *cp, const arma::uword *ri,
+const arma::uvec &pos);
+
+/*
+    The following functions return the adjacency graph of the sparsity
+    pattern of Q in CSC form (cp, ri), and false if Q is dense (in which
+    case there is no gather to make local).
+*/
+template<typename eT>
+bool pattern(const arma::Mat<eT> &Q, arma::uvec &cp, arma::uvec &ri);
+
+template<typename eT>
+bool pattern(const arma::SpMat<eT> &Q, arma::uvec &cp, arma::uvec &ri);
+
+template<typename eT>
+bool pattern(const symmat_t<eT> &Q, arma::uvec &cp, arma::uvec &ri);
+
+template<typename eT>
+bool pattern(const spsymmat_t<eT> &Q, arma::uvec &cp, arma::uvec &ri);
+
+template<typename eT>
+bool pattern(const spauto_t<eT> &Q, arma::uvec &cp, arma::uvec &ri);
+
+// The actual implementation is defined in the file Ordering.cpp.
+#include "Ordering.cpp"
+
+#endif
@@ -0,0 +1,430 @@
+/*
+    File:       Parse.cpp
+    Authors:    Matteo Loporchio, Davide Rucci
+
+    Computational Mathematics for Learning and Data Analysis 2018/2019
+*/
+
+#ifndef PARSE_IMPL_
+#define PARSE_IMPL_
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include "Parse.hpp"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+const size_t PARSE_NONE = (size_t) -1;
+
+// Returns the number of threads used by the parsers.
+inline int parse_threads() {
+    #ifdef _OPENMP
+    return omp_get_max_threads();
+    #else
+    return 1;
+    #endif
+}
+
+// Returns true if c separates two numbers of a line.
+inline bool is_sep(char c) {
+    return c == ',' || c == ' ' || c == '\t' || c == ';' || c == '\r';
+}
+
+// Parses a floating-point number with strtod, from a terminated copy of
+// [p, e). Returns the end of the number (p if there is none).
+template<typename T>
+inline const char *parse_strtod(const char *p, const char *e, T &v) {
+    char buf[64];
+    size_t n = 0;
+    while (p + n < e && !is_sep(p[n]) && n < sizeof(buf) - 1) {
+        buf[n] = p[n];
+        n++;
+    }
+    buf[n] = 0;
+    char *end;
+    v = (T) std::strtod(buf, &end);
+    return p + (end - buf);
+}
+
+/*
+    Parses the next number of the line [p, e) into v and moves p past it.
+    Returns 1 if a number was read, 0 at the end of the line and -1 if the
+    line is malformed. Numbers that are out of range for from_chars (such
+    as subnormals) are parsed again with strtod.
+*/
+template<typename T>
+inline int next_num(const char *&p, const char *e, T &v) {
+    while (p < e && is_sep(*p)) p++;
+    if (p == e) return 0;
+    if (*p == '+') p++;
+    const char *q;
+    if constexpr (std::is_integral<T>::value) {
+        auto r = std::from_chars(p, e, v);
+        if (r.ec != std::errc()) return -1;
+        q = r.ptr;
+    }
+    else {
+        #if defined(__cpp_lib_to_chars)
+        auto r = std::from_chars(p, e, v);
+        if (r.ec == std::errc::result_out_of_range) q = parse_strtod(p, e, v);
+        else if (r.ec != std::errc()) return -1;
+        else q = r.ptr;
+        #else
+        q = parse_strtod(p, e, v);
+        #endif
+        if (q == p) return -1;
+    }
+    if (q < e && !is_sep(*q)) return -1;
+    p = q;
+    return 1;
+}
+
+// Calls f(b, e) for each nonempty line [b, e) of the range [p, end),
+// where b is the first character that is not a separator.
+template<typename F>
+inline void for_lines(const char *p, const char *end, F f) {
+    while (p < end) {
+        const char *nl = (const char *) std::memchr(p, '\n', end - p);
+        if (!nl) nl = end;
+        const char *q = p;
+        while (q < nl && is_sep(*q)) q++;
+        if (q < nl) f(q, nl);
+        p = nl + 1;
+    }
+}
+
+// Raises the error for the line at offset pos of a file. The newlines
+// before it are only counted here, so the number of the line includes
+// the empty lines skipped by the parsers.
+[[noreturn]] inline void parse_error(const text_t &t, size_t pos) {
+    const char *b = t.cut.front();
+    size_t line = std::count(b, b + pos, '\n') + 1;
+    throw std::runtime_error("Error while parsing line " +
+    std::to_string(line) + " of file: " + t.path);
+}
+
+// Raises the error for the first chunk with a malformed line, where
+// bad[k] is the offset of the first one in chunk k.
+inline void parse_check(const text_t &t, const std::vector<size_t> &bad) {
+    for (size_t k = 0; k < bad.size(); k++) {
+        if (bad[k] != PARSE_NONE) parse_error(t, bad[k]);
+    }
+}
+
+// Maps a text file and splits it into chunks that end at a newline:
+// about four chunks per thread, of at least 64 KB.
+inline void text_open(const std::string &path, text_t &t) {
+    t.path = path;
+    t.map = map_file(path);
+    const char *b = t.map.data.get(), *e = b + t.map.size;
+    size_t nc = std::max<size_t>(1,
+        std::min<size_t>(4 * parse_threads(), t.map.size >> 16));
+    t.cut.assign(1, b);
+    for (size_t k = 1; k < nc; k++) {
+        const char *p = std::max(b + (t.map.size * k) / nc, t.cut.back());
+        const char *nl = (const char *) std::memchr(p, '\n', e - p);
+        t.cut.push_back((nl) ? nl + 1 : e);
+    }
+    t.cut.push_back(e);
+}
+
+// Releases the pages of chunk k after a pass: the next pass maps them
+// again from the page cache, so the whole text is never resident at once.
+inline void text_done(const text_t &t, size_t k) {
+    map_release(t.cut[k], t.cut[k + 1] - t.cut[k]);
+}
+
+// Counts the nonempty lines of each chunk: chunk k starts at line
+// lines[k], and lines[n_chunks] is the total.
+inline std::vector<size_t> count_lines(const text_t &t) {
+    long long nc = (long long) t.n_chunks();
+    std::vector<size_t> lines(nc + 1, 0);
+    #pragma omp parallel for schedule(dynamic)
+    for (long long k = 0; k < nc; k++) {
+        size_t n = 0;
+        for_lines(t.cut[k], t.cut[k + 1], [&n](const char *, const char *) {
+            n++;
+        });
+        lines[k + 1] = n;
+        text_done(t, k);
+    }
+    std::partial_sum(lines.begin(), lines.end(), lines.begin());
+    return lines;
+}
+
+// Reads a CSV matrix, calling alloc(rows, cols) and then sink(i, j, v)
+// for each entry. The number of columns is given by the first line.
+template<typename A, typename S>
+void parse_csv(const std::string &path, A alloc, S sink) {
+    text_t t;
+    text_open(path, t);
+    std::vector<size_t> lines = count_lines(t);
+    size_t rows = lines.back(), cols = 0;
+    const char *p = t.cut.front(), *end = t.cut.back();
+    while (p < end && cols == 0) {
+        const char *nl = (const char *) std::memchr(p, '\n', end - p);
+        if (!nl) nl = end;
+        double v;
+        while (next_num(p, nl, v) > 0) cols++;
+        p = nl + 1;
+    }
+    alloc(rows, cols);
+    long long nc = (long long) t.n_chunks();
+    size_t bad = PARSE_NONE;
+    #pragma omp parallel for schedule(dynamic) reduction(min:bad)
+    for (long long k = 0; k < nc; k++) {
+        size_t i = lines[k];
+        for_lines(t.cut[k], t.cut[k + 1], [&](const char *p, const char *e) {
+            size_t pos = p - t.cut.front();
+            double v;
+            size_t j = 0;
+            int s;
+            while ((s = next_num(p, e, v)) > 0) {
+                if (j < cols) sink(i, j, v);
+                j++;
+            }
+            if ((s < 0 || j != cols) && pos < bad) bad = pos;
+            i++;
+        });
+        text_done(t, k);
+    }
+    if (bad != PARSE_NONE) parse_error(t, bad);
+}
+
+// Reads a CSV matrix into A.
+template<typename eT>
+void parse_csv(const std::string &path, arma::Mat<eT> &A) {
+    parse_csv(path, [&A](size_t rows, size_t cols) { A.set_size(rows, cols); },
+    [&A](size_t i, size_t j, double v) { A.at(i, j) = (eT) v; });
+}
+
+/*
+    Makes the first pass of the list parsers: counts the nonempty lines
+    and the numbers of each chunk (as offsets, in lines and nums) and
+    checks that every number is a valid index below max.
+*/
+inline void count_lists(const text_t &t, uint64_t max,
+std::vector<size_t> &lines, std::vector<size_t> &nums) {
+    long long nc = (long long) t.n_chunks();
+    lines.assign(nc + 1, 0);
+    nums.assign(nc + 1, 0);
+    std::vector<size_t> bad(nc, PARSE_NONE);
+    #pragma omp parallel for schedule(dynamic)
+    for (long long k = 0; k < nc; k++) {
+        size_t l = 0, n = 0;
+        for_lines(t.cut[k], t.cut[k + 1], [&](const char *p, const char *e) {
+            size_t pos = p - t.cut.front();
+            uint64_t v;
+            int s;
+            while ((s = next_num(p, e, v)) > 0 && v <= max) n++;
+            if (s != 0 && bad[k] == PARSE_NONE) bad[k] = pos;
+            l++;
+        });
+        lines[k + 1] = l;
+        nums[k + 1] = n;
+        text_done(t, k);
+    }
+    std::partial_sum(lines.begin(), lines.end(), lines.begin());
+    std::partial_sum(nums.begin(), nums.end(), nums.begin());
+    parse_check(t, bad);
+}
+
+// Reads all the numbers of a file into v, in order.
+template<typename eT>
+void parse_flat(const std::string &path, arma::Col<eT> &v) {
+    text_t t;
+    text_open(path, t);
+    long long nc = (long long) t.n_chunks();
+    std::vector<size_t> nums(nc + 1, 0), bad(nc, PARSE_NONE);
+    #pragma omp parallel for schedule(dynamic)
+    for (long long k = 0; k < nc; k++) {
+        size_t n = 0;
+        for_lines(t.cut[k], t.cut[k + 1], [&](const char *p, const char *e) {
+            size_t pos = p - t.cut.front();
+            double x;
+            int s;
+            while ((s = next_num(p, e, x)) > 0) n++;
+            if (s < 0 && bad[k] == PARSE_NONE) bad[k] = pos;
+        });
+        nums[k + 1] = n;
+        text_done(t, k);
+    }
+    parse_check(t, bad);
+    std::partial_sum(nums.begin(), nums.end(), nums.begin());
+    v.set_size(nums.back());
+    eT *pv = v.memptr();
+    #pragma omp parallel for schedule(dynamic)
+    for (long long k = 0; k < nc; k++) {
+        size_t n = nums[k];
+        for_lines(t.cut[k], t.cut[k + 1], [&](const char *p, const char *e) {
+            double x;
+            while (next_num(p, e, x) > 0) pv[n++] = (eT) x;
+        });
+        text_done(t, k);
+    }
+}
+
+// Reads a list of lines of indices.
+template<typename iT>
+void parse_lists(const std::string &path, std::vector<iT> &off,
+std::vector<iT> &idx) {
+    text_t t;
+    text_open(path, t);
+    std::vector<size_t> lines, nums;
+    count_lists(t, std::numeric_limits<iT>::max(), lines, nums);
+    off.resize(lines.back() + 1);
+    idx.resize(nums.back());
+    off[0] = 0;
+    long long nc = (long long) t.n_chunks();
+    #pragma omp parallel for schedule(dynamic)
+    for (long long k = 0; k < nc; k++) {
+        size_t l = lines[k], n = nums[k];
+        for_lines(t.cut[k], t.cut[k + 1], [&](const char *p, const char *e) {
+            uint64_t v;
+            while (next_num(p, e, v) > 0) idx[n++] = (iT) v;
+            off[++l] = (iT) n;
+        });
+        text_done(t, k);
+    }
+}
+
+// Reads the entry "i j v" of a line of a coordinate file. Only i and j are
+// read if v is null. Returns false if the line is malformed.
+inline bool read_entry(const char *p, const char *e, uint64_t &i,
+uint64_t &j, double *v) {
+    if (next_num(p, e, i) <= 0 || next_num(p, e, j) <= 0) return false;
+    if (!v) return true;
+    double x;
+    return (next_num(p, e, *v) > 0 && next_num(p, e, x) == 0);
+}
+
+/*
+    Reads a sparse matrix in coordinate format. The first pass checks the
+    entries and finds the size of the matrix, the second one counts the
+    entries of each column and the third one moves each entry to its
+    column. The columns are then sorted by row, and compacted only if
+    they hold zeros or repeated entries.
+*/
+template<typename eT>
+void parse_coord(const std::string &path, arma::SpMat<eT> &A, bool upper) {
+    text_t t;
+    text_open(path, t);
+    long long nc = (long long) t.n_chunks();
+    std::vector<size_t> bad(nc, PARSE_NONE);
+    arma::uword n_rows = 0, n_cols = 0;
+    #pragma omp parallel for schedule(dynamic) reduction(max:n_rows, n_cols)
+    for (long long k = 0; k < nc; k++) {
+        for_lines(t.cut[k], t.cut[k + 1], [&](const char *p, const char *e) {
+            uint64_t i, j;
+            double v;
+            if (!read_entry(p, e, i, j, &v)) {
+                if (bad[k] == PARSE_NONE) bad[k] = p - t.cut.front();
+            }
+            else if (!upper || i <= j) {
+                n_rows = std::max<arma::uword>(n_rows, i + 1);
+                n_cols = std::max<arma::uword>(n_cols, j + 1);
+            }
+        });
+        text_done(t, k);
+    }
+    parse_check(t, bad);
+    // Count the entries of each column.
+    std::vector<arma::uword> cnt(n_cols + 1, 0);
+    #pragma omp parallel for schedule(dynamic)
+    for (long long k = 0; k < nc; k++) {
+        for_lines(t.cut[k], t.cut[k + 1], [&](const char *p, const char *e) {
+            uint64_t i, j;
+            read_entry(p, e, i, j, nullptr);
+            if (upper && i > j) return;
+            #pragma omp atomic
+            cnt[j + 1]++;
+        });
+        text_done(t, k);
+    }
+    std::partial_sum(cnt.begin(), cnt.end(), cnt.begin());
+    // Move the entries to the CSC arrays of A.
+    A.set_size(n_rows, n_cols);
+    A.mem_resize(cnt[n_cols]);
+    arma::uword *cp = const_cast<arma::uword *>(A.col_ptrs);
+    arma::uword *ri = const_cast<arma::uword *>(A.row_indices);
+    eT *val = const_cast<eT *>(A.values);
+    std::vector<arma::uword> pos(cnt.begin(), cnt.end() - 1);
+    #pragma omp parallel for schedule(dynamic)
+    for (long long k = 0; k < nc; k++) {
+        for_lines(t.cut[k], t.cut[k + 1], [&](const char *p, const char *e) {
+            uint64_t i, j;
+            double v;
+            read_entry(p, e, i, j, &v);
+            if (upper && i > j) return;
+            arma::uword s;
+            #pragma omp atomic capture
+            s = pos[j]++;
+            ri[s] = i;
+            val[s] = (eT) v;
+        });
+        text_done(t, k);
+    }
+    // Sort the columns by row, then merge the repeated entries and drop
+    // the zeros: len[j] is the new length of column j.
+    std::vector<arma::uword> len(n_cols);
+    arma::uword nnz = 0;
+    #pragma omp parallel reduction(+:nnz)
+    {
+        std::vector<std::pair<arma::uword, eT>> buf;
+        #pragma omp for schedule(dynamic, 64)
+        for (long long j = 0; j < (long long) n_cols; j++) {
+            arma::uword lo = cnt[j], hi = cnt[j + 1], w = lo;
+            if (!std::is_sorted(ri + lo, ri + hi)) {
+                buf.resize(hi - lo);
+                for (arma::uword s = lo; s < hi; s++) {
+                    buf[s - lo] = {ri[s], val[s]};
+                }
+                std::sort(buf.begin(), buf.end(), [](const auto &a,
+                const auto &b) { return a.first < b.first; });
+                for (arma::uword s = lo; s < hi; s++) {
+                    ri[s] = buf[s - lo].first;
+                    val[s] = buf[s - lo].second;
+                }
+            }
+            for (arma::uword s = lo; s < hi; s++) {
+                if (w > lo && ri[w - 1] == ri[s]) val[w - 1] += val[s];
+                else {
+                    ri[w] = ri[s];
+                    val[w++] = val[s];
+                }
+            }
+            arma::uword z = lo;
+            for (arma::uword s = lo; s < w; s++) {
+                if (val[s] != eT(0)) {
+                    ri[z] = ri[s];
+                    val[z++] = val[s];
+                }
+            }
+            len[j] = z - lo;
+            nnz += len[j];
+        }
+    }
+    // Close the gaps left by the merged entries (if any).
+    arma::uword w = 0;
+    for (arma::uword j = 0; j < n_cols; j++) {
+        if (nnz != cnt[n_cols]) {
+            std::copy(ri + cnt[j], ri + cnt[j] + len[j], ri + w);
+            std::copy(val + cnt[j], val + cnt[j] + len[j], val + w);
+        }
+        cp[j] = w;
+        w += len[j];
+    }
+    cp[n_cols] = w;
+    if (nnz != cnt[n_cols]) A.mem_resize(nnz);
+}
+
+#endif
@@ -0,0 +1,78 @@
+/*
+    File:       Parse.hpp
+    Authors:    Matteo Loporchio, Davide Rucci
+
+    Computational Mathematics for Learning and Data Analysis 2018/2019
+*/
+
+#ifndef PARSE_H
+#define PARSE_H
+
+#define ARMA_DONT_USE_WRAPPER
+#include <armadillo>
+#include <string>
+#include <vector>
+#include "Config.hpp"
+#include "MapFile.hpp"
+
+/*
+    Parallel parsers of the text files of a problem. A file is mapped in
+    memory and split into chunks that end at a newline, which are parsed
+    by all the OpenMP threads with std::from_chars. Each parser makes a
+    first pass over the chunks to count the lines (or the entries) of each
+    one, so that the output can be allocated once and each chunk written
+    at its own offset in the second pass.
+    The numbers of a line can be separated by commas, semicolons, spaces
+    or tabs, and empty lines are skipped. A malformed file raises
+    std::runtime_error with the number of the offending line.
+*/
+
+// Text file mapped in memory and split into chunks.
+struct text_t {
+    std::string path;                   // Path of the file.
+    mapping_t map;                      // Mapping of the file.
+    std::vector<const char *> cut;      // Chunk k is [cut[k], cut[k + 1]).
+
+    // Returns the number of chunks.
+    size_t n_chunks() const { return cut.size() - 1; }
+};
+
+// Maps a text file and splits it into chunks that end at a newline.
+void text_open(const std::string &path, text_t &t);
+
+/*
+    Reads a CSV matrix. After the first pass, alloc(rows, cols) is called
+    once with the size of the matrix, then sink(i, j, v) is called in
+    parallel for each entry (i, j) with value v.
+*/
+template<typename A, typename S>
+void parse_csv(const std::string &path, A alloc, S sink);
+
+// Reads a CSV matrix into A.
+template<typename eT>
+void parse_csv(const std::string &path, arma::Mat<eT> &A);
+
+// Reads all the numbers of a file into v, in order.
+template<typename eT>
+void parse_flat(const std::string &path, arma::Col<eT> &v);
+
+// Reads a list of lines of indices: the indices of line i are stored in
+// idx[off[i]], ..., idx[off[i + 1] - 1].
+template<typename iT>
+void parse_lists(const std::string &path, std::vector<iT> &off,
+std::vector<iT> &idx);
+
+/*
+    Reads a sparse matrix in coordinate format (one "i j v" entry per line,
+    with zero-based indices) directly into the CSC arrays of A. The size
+    of A is given by the largest indices. If upper is true, only the entries
+    with i <= j are kept. Zeros are dropped and repeated entries summed.
+*/
+template<typename eT>
+void parse_coord(const std::string &path, arma::SpMat<eT> &A,
+bool upper = false);
+
+// The actual implementation is defined in the file Parse.cpp.
+#include "Parse.cpp"
+
+#endif
@@ -10,91 +10,290 @@
 
 #include "Problem.hpp"
 #include "Config.hpp"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// Returns the number of threads to be used.
+template<typename T>
+int QProblem<T>::threads() {
+    #ifdef _OPENMP
+    return (nt > 0) ? nt : omp_get_max_threads();
+    #else
+    return 1;
+    #endif
+}
 
-// Computes the currently active constraints.
+// Performs a line search in the interval [0, alpha_bar].
 template<typename T>
-void QProblem<T>::set_active(const arma::vec &x, arma::uvec &act, double eps) {
-    for (arma::uword i = 0; i < x.n_elem; i++) act(i) = (x(i) <= eps);
+double QProblem<T>::line_search(double gd, double dl, double alpha_bar,
+double eps) {
+    if (dl <= eps) return alpha_bar;
+    return fmin(alpha_bar, -gd / dl);
 }
 
-// Computes the maximum feasible stepsize.
+// Computes the lists of free variables of the starting point.
 template<typename T>
-double QProblem<T>::max_step(const arma::vec &x, const arma::vec &d,
-const arma::uvec &act, double eps) {
-    double step = arma::datum::inf;
-    for (arma::uword i = 0; i < x.n_elem; i++) {
-        if (!act(i) && -d(i) > eps) step = fmin(step, -x(i)/d(i));
+void QProblem<T>::init_free(PGMWorkspace &ws, double ctol) {
+    const arma::vec &x = ws.x;
+    for (size_t b = 0; b < c.size(); b++) {
+        cidx_t nf = 0;
+        for (cidx_t k = c.off[b]; k < c.off[b + 1]; k++) {
+            cidx_t i = c.idx[k];
+            if (x(i) > ctol) ws.free[c.off[b] + nf++] = i;
+        }
+        ws.nfree[b] = nf;
     }
-    return step;
+    ws.dirty = true;
 }
 
-// Performs a line search in the interval [0, alpha_bar].
+/*
+    Updates the active set, then computes the projected direction d,
+    its squared norm, the product g^T * d and the maximum feasible
+    stepsize in one call. Each thread processes a group of blocks.
+*/
+template<typename T>
+dstat_t QProblem<T>::project(PGMWorkspace &ws, double ctol, double dtol) {
+    double norm2 = 0, gd = 0, step = arma::datum::inf;
+    bool changed = false;
+    int np = (int) ws.part.size() - 1;
+    #pragma omp parallel for num_threads(np) schedule(static, 1) \
+    reduction(+:norm2, gd) reduction(min:step) reduction(||:changed)
+    for (int t = 0; t < np; t++) {
+        dstat_t s;
+        for (size_t b = ws.part[t]; b < ws.part[t + 1]; b++) {
+            sub_proj(b, ws, ctol, dtol, s);
+        }
+        norm2 += s.norm2;
+        gd += s.gd;
+        step = fmin(step, s.step);
+        changed = changed || s.changed;
+    }
+    if (changed) ws.dirty = true;
+    if (ws.dirty) {
+        ws.nsupp = 0;
+        for (size_t b = 0; b < c.size(); b++) {
+            const cidx_t *f = ws.free.data() + c.off[b];
+            std::copy(f, f + ws.nfree[b], ws.supp.data() + ws.nsupp);
+            ws.nsupp += ws.nfree[b];
+        }
+        split(Q, ws.supp.data(), ws.nsupp, ws.fpart.size() - 1, ws.spart);
+        ws.dirty = false;
+    }
+    dstat_t s;
+    s.norm2 = norm2;
+    s.gd = gd;
+    s.step = step;
+    s.changed = changed;
+    return s;
+}
+
+// Applies the projection kernel to the b-th block.
+template<typename T>
+void QProblem<T>::sub_proj(size_t b, PGMWorkspace &ws, double ctol,
+double dtol, dstat_t &s) {
+    const arma::vec &x = ws.x, &g = ws.g;
+    arma::vec &d = ws.d;
+    cidx_t *f = ws.free.data() + c.off[b];
+    cidx_t nf = ws.nfree[b], w = 0;
+    // Drop the variables that have become active: the direction is zero
+    // on them from now on.
+    for (cidx_t j = 0; j < nf; j++) {
+        cidx_t i = f[j];
+        if (x(i) <= ctol) d(i) = 0;
+        else f[w++] = i;
+    }
+    if (w < nf) s.changed = true;
+    ws.nfree[b] = nf = w;
+    if (nf == 0) return;
+    // Mean of the gradient over the free variables, then direction,
+    // reductions and ratio test.
+    const cidx_t *fi = gathered(f, nf);
+    double m = vsum(g.memptr(), fi, f[0], nf) / (double) nf;
+    vdirection(fi, f[0], nf, m, x.memptr(), g.memptr(), d.memptr(), dtol,
+    s.norm2, s.gd, s.step);
+}
+
+// Objective function for a point in the internal ordering.
+template<typename T>
+double QProblem<T>::obj(const arma::vec &x) {
+    arma::vec y(x.n_elem);
+    std::vector<size_t> part;
+    split(Q, nullptr, x.n_elem, threads(), part);
+    return mul_dot(Q, 1, x, y, part) + arma::dot(q, x);
+}
+
+// Maps a vector from the original ordering to the internal one.
+template<typename T>
+arma::vec QProblem<T>::to_internal(const arma::vec &x) {
+    if (p.is_empty()) return x;
+    return x.elem(p);
+}
+
+// Maps a vector from the internal ordering to the original one.
 template<typename T>
-double QProblem<T>::line_search(const arma::vec &g, const arma::vec &d,
-const arma::vec &l, double alpha_bar, double eps) {
-    double den = arma::dot(d, l);
-    if (den <= eps) return alpha_bar;
-    return fmin(alpha_bar, -arma::dot(g, d) / den);
+arma::vec QProblem<T>::to_original(const arma::vec &x) {
+    if (p.is_empty()) return x;
+    arma::vec y(x.n_elem);
+    y.elem(p) = x;
+    return y;
+}
+
+// Applies the symmetric permutation Q = Q(p, p) in place.
+// Rows are gathered one column at a time and columns are moved
+// along the cycles of the permutation, so only O(n) extra memory is used.
+template<typename eT>
+void permute(arma::Mat<eT> &Q, const arma::uvec &p) {
+    arma::Col<eT> buf(Q.n_rows);
+    for (arma::uword j = 0; j < Q.n_cols; j++) {
+        eT *col = Q.colptr(j);
+        for (arma::uword i = 0; i < Q.n_rows; i++) buf(i) = col[p(i)];
+        std::copy(buf.begin(), buf.end(), col);
+    }
+    std::vector<bool> done(Q.n_cols, false);
+    for (arma::uword s = 0; s < Q.n_cols; s++) {
+        if (done[s]) continue;
+        buf = Q.col(s);
+        arma::uword j = s;
+        while (p(j) != s) {
+            Q.col(j) = Q.col(p(j));
+            done[j] = true;
+            j = p(j);
+        }
+        Q.col(j) = buf;
+        done[j] = true;
+    }
+}
+
+// Applies the symmetric permutation Q = Q(p, p) by rebuilding the matrix.
+template<typename eT>
+void permute(arma::SpMat<eT> &Q, const arma::uvec &p) {
+    arma::uvec inv(p.n_elem);
+    inv.elem(p) = arma::regspace<arma::uvec>(0, p.n_elem - 1);
+    arma::umat loc(2, Q.n_nonzero);
+    arma::Col<eT> val(Q.n_nonzero);
+    arma::uword k = 0;
+    for (auto it = Q.begin(); it != Q.end(); ++it) {
+        loc(0, k) = inv(it.row());
+        loc(1, k) = inv(it.col());
+        val(k++) = (*it);
+    }
+    Q = arma::SpMat<eT>(loc, val, Q.n_rows, Q.n_cols);
+}
+
+// Applies the symmetric permutation Q = Q(p, p) to a packed matrix.
+template<typename eT>
+void permute(symmat_t<eT> &Q, const arma::uvec &p) {
+    symmat_t<eT> R;
+    R.set_size(Q.n_cols);
+    for (arma::uword j = 0; j < Q.n_cols; j++) {
+        eT *col = R.colptr(j);
+        for (arma::uword i = 0; i <= j; i++) col[i] = Q.at(p(i), p(j));
+    }
+    Q = std::move(R);
+}
+
+// Applies the symmetric permutation Q = Q(p, p) to the upper triangle
+// of a sparse matrix: entries that fall below the diagonal are mirrored.
+template<typename eT>
+void permute(spsymmat_t<eT> &Q, const arma::uvec &p) {
+    arma::uvec inv(p.n_elem);
+    inv.elem(p) = arma::regspace<arma::uvec>(0, p.n_elem - 1);
+    arma::umat loc(2, Q.U.n_nonzero);
+    arma::Col<eT> val(Q.U.n_nonzero);
+    arma::uword k = 0;
+    for (auto it = Q.U.begin(); it != Q.U.end(); ++it) {
+        arma::uword r = inv(it.row()), c = inv(it.col());
+        loc(0, k) = std::min(r, c);
+        loc(1, k) = std::max(r, c);
+        val(k++) = (*it);
+    }
+    Q.U = arma::SpMat<eT>(loc, val, Q.n_rows, Q.n_cols);
 }
 
-// Computes the projection of the gradient onto the subspace A_bar * d = 0.
+// Applies the symmetric permutation Q = Q(p, p) to a matrix in automatic
+// format: the format is chosen again, since it depends on the ordering.
+template<typename eT>
+void permute(spauto_t<eT> &Q, const arma::uvec &p) {
+    arma::SpMat<eT> A = Q.to_spmat();
+    permute(A, p);
+    Q.set(std::move(A));
+}
+
+// Makes sure that the buffers can hold n variables and the
+// free lists of the blocks of c.
+inline void PGMWorkspace::reserve(arma::uword n, const cstlist_t &c) {
+    fit(x, n); fit(g, n); fit(d, n); fit(l, n);
+    fit(free, c.idx.size());
+    fit(nfree, c.size());
+    fit(supp, c.idx.size());
+}
+
+// Checks the size of Q once, since the kernels index Q and the vectors
+// of the solver without bounds checking.
 template<typename T>
-arma::vec QProblem<T>::project(const arma::uvec &act, const arma::vec &g) {
-    arma::vec d = arma::zeros(g.n_elem);
-    // For each simplex...
-    for (size_t i = 0; i < c.size(); i++) {
-        // Extract the corresponding block.
-        arma::uvec idx = c.at(i);
-        // Project onto the single block.
-        d(idx) = sub_proj(g(idx), act(idx));
+void QProblem<T>::check_size() {
+    if (Q.n_rows != q.n_elem || Q.n_cols != q.n_elem) {
+        throw std::runtime_error("The size of Q does not match the number of "
+        "variables of the problem.");
     }
-    return d;
 }
 
-// Projects the gradient onto the single block of coordinates.
 template<typename T>
-arma::vec QProblem<T>::sub_proj(const arma::vec &g, const arma::uvec &act) {
-    arma::uword n = g.n_elem;
-    // Compute the number of active constraints.
-    arma::uword nact = arma::accu(act);
-    // Create the result vector.
-    arma::vec d = arma::zeros(n);
-    // Compute the mean over the non active constraints.
-    double m = 0;
-    for (arma::uword i = 0; i < d.n_elem; i++) if (!act(i)) m += g(i);
-    m /= (double)(n - nact);
-    // Set the components of the result.
-    for (arma::uword i = 0; i < d.n_elem; i++) d(i) = ((act(i)) ? 0 : m - g(i));
-    return d;
+QProblem<T>::QProblem(const T &Q, const arma::vec &q, const cstlist_t &c)
+: Q(Q), q(q), c(c) {
+    check_size();
+}
+
+template<typename T>
+QProblem<T>::QProblem(T &&Q, arma::vec &&q, cstlist_t &&c, mapping_t aux)
+: Q(std::move(Q)), q(std::move(q)), c(std::move(c)), aux(std::move(aux)) {
+    check_size();
 }
 
+// Saves the problem into a binary container.
 template<typename T>
-QProblem<T>::QProblem(T &Q, arma::vec &q, cstlist_t &c) {
-    this -> Q = Q;
-    this -> q = q;
-    this -> c = c;
+void QProblem<T>::save(const std::string &path) const {
+    if (p.n_elem > 0) {
+        throw std::runtime_error("A reordered problem cannot be saved.");
+    }
+    save_binary(path, Q, q, c.off, c.idx);
 }
 
 // This is the objective function.
 template<typename T>
 double QProblem<T>::f(const arma::vec &x) {
-    return arma::dot(x, Q * x) + arma::dot(q, x);
+    return obj(to_internal(x));
 }
 
 // This is the gradient of the objective function.
 template<typename T>
 arma::vec QProblem<T>::gf(const arma::vec &x) {
-    return 2 * (Q * x) + q;
+    arma::vec g(x.n_elem);
+    std::vector<size_t> part;
+    split(Q, nullptr, x.n_elem, threads(), part);
+    mul(Q, 2, to_internal(x), g, part);
+    return to_original(g + q);
 }
 
 // This method checks if a point is in the feasible region of the problem.
 template<typename T>
-bool QProblem<T>::is_feasible(const arma::vec &x, double eps) {
-    for (size_t i = 0; i < c.size(); i++) {
-        arma::uvec idx = c.at(i);
-        if (fabs(arma::accu(x(idx)) - 1) > eps) return false;
+bool QProblem<T>::is_feasible(const arma::vec &x_0, double eps) {
+    arma::vec x = to_internal(x_0);
+    std::vector<size_t> part;
+    c.split(threads(), part);
+    bool feasible = true;
+    int np = (int) part.size() - 1;
+    #pragma omp parallel for num_threads(np) schedule(static, 1) \
+    reduction(&&:feasible)
+    for (int t = 0; t < np; t++) {
+        for (size_t i = part[t]; i < part[t + 1]; i++) {
+            double sum = 0;
+            for (cidx_t j : c[i]) sum += x(j);
+            if (fabs(sum - 1) > eps) feasible = false;
+        }
     }
-    return arma::all(x >= -eps);
+    return feasible && arma::all(x >= -eps);
 }
 
 /*
@@ -104,11 +303,111 @@ bool QProblem<T>::is_feasible(const arma::vec &x, double eps) {
 template<typename T>
 arma::vec QProblem<T>::initial_point() {
     arma::vec result = arma::zeros(q.n_elem);
-    for (size_t i = 0; i < c.size(); i++) {
-        arma::uvec idx = c.at(i);
-        result(idx).fill(1.0 / ((double) idx.n_elem));
+    std::vector<size_t> part;
+    c.split(threads(), part);
+    int np = (int) part.size() - 1;
+    #pragma omp parallel for num_threads(np) schedule(static, 1)
+    for (int t = 0; t < np; t++) {
+        for (size_t i = part[t]; i < part[t + 1]; i++) {
+            cblock_t idx = c[i];
+            for (cidx_t j : idx) result(j) = 1.0 / ((double) idx.size());
+        }
     }
-    return result;
+    return to_original(result);
+}
+
+/*
+    Presolve stage that renumbers the variables so that the indices of each
+    block of the constraint list are sorted and, if possible, contiguous.
+    If RCM is set and Q is sparse, the variables are sorted by their RCM
+    rank, then each window of consecutive ranks is sorted by block (in the
+    RCM order of the graph of the blocks). A single window makes every
+    block contiguous, so the vector kernels skip the gathers, but scattered
+    blocks then pull adjacent variables far apart. Windows of RCM_WINDOW
+    variables keep the entries of Q within a window of the diagonal, and
+    give each block runs of consecutive variables. They are used if the
+    mean distance of the entries of Q from the diagonal is RCM_SLACK times
+    smaller with them.
+*/
+template<typename T>
+void QProblem<T>::reorder() {
+    arma::uword n = q.n_elem, ng = c.size();
+    if (sorted || n == 0) return;
+    // The permutations gather the rows of Q with the indices of q.
+    check_size();
+    // Group of each variable: its block, or a group of its own for the
+    // variables outside the blocks. If Q is not sparse, the variables are
+    // ranked in the order of the constraint list.
+    const arma::uword none = n + ng;
+    arma::uvec group(n), rank(n), grank, cp, ri;
+    group.fill(none);
+    for (size_t b = 0; b < c.size(); b++) {
+        for (cidx_t k = c.off[b]; k < c.off[b + 1]; k++) {
+            cidx_t j = c.idx[k];
+            if (j >= n || group(j) != none) {
+                throw std::runtime_error("The blocks of the constraint list "
+                "must be disjoint subsets of the variables.");
+            }
+            group(j) = b;
+            rank(j) = k;
+        }
+    }
+    for (arma::uword j = 0, m = c.idx.size(); j < n; j++) {
+        if (group(j) == none) {
+            group(j) = ng++;
+            rank(j) = m++;
+        }
+    }
+    grank = arma::regspace<arma::uvec>(0, ng - 1);
+    bool sparse = (RCM && pattern(Q, cp, ri));
+    if (sparse) {
+        rcm(n, cp.memptr(), ri.memptr(), rank);
+        rcm_groups(n, cp.memptr(), ri.memptr(), group, ng, grank);
+    }
+    // Build the permutation that splits the ranks into windows of w
+    // variables and sorts each window by group, then by rank: p(i) is the
+    // original index of variable i, and pos is its inverse.
+    arma::uvec pos(n);
+    auto by_window = [&](arma::uword w) {
+        p = arma::regspace<arma::uvec>(0, n - 1);
+        std::sort(p.begin(), p.end(), [&](arma::uword a, arma::uword b) {
+            arma::uword wa = rank(a) / w, wb = rank(b) / w;
+            arma::uword ga = grank(group(a)), gb = grank(group(b));
+            if (wa != wb) return wa < wb;
+            return (ga != gb) ? ga < gb : rank(a) < rank(b);
+        });
+        pos.elem(p) = arma::regspace<arma::uvec>(0, n - 1);
+        return (sparse) ? mean_dist(n, cp.memptr(), ri.memptr(), pos) : 0;
+    };
+    // A single window keeps the blocks contiguous. Smaller windows hold
+    // about 8 variables of each block (a cache line) on average.
+    arma::uword w = std::max<arma::uword>(RCM_WINDOW, 8 * c.size());
+    double dist = by_window(n);
+    if (sparse && w < n && dist <= RCM_SLACK * by_window(w)) by_window(n);
+    // Apply it to the problem. The blocks are renumbered, sorted and then
+    // ordered by their first variable.
+    permute(Q, p);
+    q = q.elem(p);
+    for (cidx_t &j : c.idx) j = (cidx_t) pos(j);
+    std::vector<size_t> order(c.size());
+    for (size_t b = 0; b < c.size(); b++) {
+        std::sort(c.idx.begin() + c.off[b], c.idx.begin() + c.off[b + 1]);
+        order[b] = b;
+    }
+    auto first = [&](size_t b) {
+        return (c.off[b] < c.off[b + 1]) ? (arma::uword) c.idx[c.off[b]] : n;
+    };
+    std::stable_sort(order.begin(), order.end(),
+    [&](size_t a, size_t b) { return first(a) < first(b); });
+    cstlist_t r;
+    r.idx.reserve(c.idx.size());
+    for (size_t b : order) {
+        r.idx.insert(r.idx.end(), c.idx.begin() + c.off[b],
+        c.idx.begin() + c.off[b + 1]);
+        r.close_block();
+    }
+    c = std::move(r);
+    sorted = true;
 }
 
 /*
@@ -119,39 +418,79 @@ arma::vec QProblem<T>::initial_point() {
         - max_iter, a limit on the number of iterations.
         - ctol, constraint tolerance.
         - dtol, norm tolerance.
+        - log, if true the value of the objective function is recorded
+          at each iteration.
 */
 template<typename T>
 QResult QProblem<T>::PGM(const arma::vec &x_0, arma::uword max_iter,
-double ctol, double dtol) {
+double ctol, double dtol, bool log) {
+    PGMWorkspace ws;
+    return PGM(x_0, max_iter, ctol, dtol, ws, log);
+}
+
+// Same as above, but runs the method inside a user-provided workspace.
+template<typename T>
+QResult QProblem<T>::PGM(const arma::vec &x_0, arma::uword max_iter,
+double ctol, double dtol, PGMWorkspace &ws, bool log) {
     auto t1 = std::chrono::high_resolution_clock::now();
     arma::uword k = 0;
-    arma::vec x = x_0, g = gf(x);
-    arma::uvec act(x.n_elem, arma::fill::zeros);
-    std::vector<double> hist;
+    ws.reserve(x_0.n_elem, c);
+    arma::vec &x = ws.x, &g = ws.g, &d = ws.d, &l = ws.l;
+    x = to_internal(x_0);
+    c.split(threads(), ws.part);
+    split(Q, nullptr, x.n_elem, threads(), ws.fpart);
+    // The split of the support has as many ranges as fpart.
+    fit(ws.spart, ws.fpart.size());
+    mul(Q, 2, x, g, ws.fpart);
+    g += q;
+    d.zeros();
+    init_free(ws, ctol);
+    int np = (int) ws.part.size() - 1;
+    // The objective function is f(x) = x^T * (g + q) / 2, and it is then
+    // updated as f(x + alpha * d) = f(x) + alpha * g^T * d
+    // + alpha^2 * d^T * Q * d, so no further product with Q is needed.
+    double v = (arma::dot(x, g) + arma::dot(x, q)) / 2;
+    ws.hist.clear();
+    if (log) ws.hist.reserve(max_iter + 1);
+    unsigned long a0 = buffer_allocs;
     while (k < max_iter) {
-        #if LOG_VAL
-        hist.push_back(f(x));
-        #endif
-        // Compute the active inequality constraints.
-        set_active(x, act, ctol);
-        // Compute the projected direction.
-        arma::vec d = project(act, g);
+        if (log) ws.hist.push_back(v);
+        // Compute the active constraints, the projected direction and
+        // the maximum step to the nearest intersecting boundary.
+        dstat_t s = project(ws, ctol, dtol);
         // Stop if the norm of the direction is (nearly) zero.
-        if (arma::norm(d) <= dtol) break;
-        // Compute the maximum step to the nearest intersecting boundary.
-        double alpha_bar = max_step(x, d, act, dtol);
+        if (s.norm2 <= dtol * dtol) break;
         // Then perform the line search.
-        arma::vec l = 2 * Q * d;
-        double alpha = line_search(g, d, l, alpha_bar);
-        // Move to the next point and update the gradient.
-        x = x + alpha * d;
-        g = g + alpha * l;
+        double dl = (ws.nsupp > MV_DENSITY * x.n_elem) ?
+        mul_dot(Q, 2, d, l, ws.fpart) :
+        mul_dot(Q, 2, d, l, ws.supp.data(), ws.nsupp, ws.spart);
+        double alpha = line_search(s.gd, dl, s.step);
+        // Move to the next point and update the gradient and the objective.
+        v += alpha * s.gd + alpha * alpha * dl / 2;
+        #pragma omp parallel for num_threads(np) schedule(static, 1)
+        for (int t = 0; t < np; t++) {
+            for (size_t b = ws.part[t]; b < ws.part[t + 1]; b++) {
+                const cidx_t *f = ws.free.data() + c.off[b];
+                if (ws.nfree[b] == 0) continue;
+                update(alpha, gathered(f, ws.nfree[b]), f[0], ws.nfree[b],
+                d, l, x, g);
+            }
+        }
         k++;
+        // With a single-precision Q, the gradient and the objective
+        // are periodically recomputed from scratch to limit the drift
+        // of the incremental updates.
+        if (REFRESH > 0 && sizeof(typename T::elem_type) < sizeof(double)
+        && k % REFRESH == 0) {
+            mul(Q, 2, x, g, ws.fpart);
+            g += q;
+            v = (arma::dot(x, g) + arma::dot(x, q)) / 2;
+        }
     }
     auto t2 = std::chrono::high_resolution_clock::now();
     unsigned long t = std::chrono::duration_cast
     <std::chrono::microseconds>(t2 - t1).count();
-    return {x, f(x), k, hist, t};
+    return {to_original(x), v, k, ws.hist, t, buffer_allocs - a0};
 }
 
 #endif
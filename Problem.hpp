@@ -10,15 +10,76 @@
 
 #define ARMA_DONT_USE_WRAPPER
 #include <armadillo>
+#include <algorithm>
 #include <chrono>
 #include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <stdexcept>
+#include "Binary.hpp"
+#include "Config.hpp"
+#include "Gram.hpp"
+#include "KerMat.hpp"
+#include "MapMat.hpp"
+#include "LowRank.hpp"
+#include "Kernels.hpp"
+#include "Operator.hpp"
+#include "Ordering.hpp"
 
 /*
-    The constraints of the problem are represented as a list of vectors.
-    Each vector contains the indices of the non-zero components of the
-    gradient of the constraint.
+    This struct is a non-owning view over the indices of a single block
+    of the constraint list.
 */
-typedef std::vector<arma::uvec> cstlist_t;
+struct cblock_t {
+    const cidx_t *ptr;  // First index of the block.
+    size_t n;           // Number of indices in the block.
+
+    size_t size() const { return n; }
+    cidx_t operator[](size_t j) const { return ptr[j]; }
+    const cidx_t *begin() const { return ptr; }
+    const cidx_t *end() const { return ptr + n; }
+};
+
+/*
+    The constraints of the problem are represented in a flat, CSR-like
+    layout. Each block lists the indices of the non-zero components of
+    the gradient of the corresponding constraint: the indices of block i
+    are stored in idx[off[i]], ..., idx[off[i + 1] - 1].
+*/
+struct cstlist_t {
+    std::vector<cidx_t> off = {0};  // Offsets of the blocks.
+    std::vector<cidx_t> idx;        // Indices of all the blocks.
+
+    // Returns the number of blocks.
+    size_t size() const { return off.size() - 1; }
+
+    // Returns a view over the indices of block i.
+    cblock_t operator[](size_t i) const {
+        return {idx.data() + off[i], (size_t) (off[i + 1] - off[i])};
+    }
+
+    // Closes the current block: all the indices appended to idx since
+    // the last call become a new block.
+    void close_block() { off.push_back((cidx_t) idx.size()); }
+
+    /*
+        Splits the blocks into np groups of consecutive blocks holding
+        about the same number of indices, so that the groups can be
+        processed in parallel with a balanced amount of work.
+        Group t is made of the blocks [part[t], part[t + 1]).
+    */
+    void split(size_t np, std::vector<size_t> &part) const {
+        part.resize(np + 1);
+        part[0] = 0;
+        for (size_t t = 1; t < np; t++) {
+            cidx_t target = (cidx_t) ((idx.size() * t) / np);
+            size_t b = std::lower_bound(off.begin(), off.end(), target)
+            - off.begin();
+            part[t] = std::max(part[t - 1], std::min(b, size()));
+        }
+        part[np] = size();
+    }
+};
 
 /*
     This struct contains the results of the projected gradient algorithm.
@@ -29,6 +90,53 @@ struct QResult {
     arma::uword n_iter;         // Total number of iterations.
     std::vector<double> hist;   // History of the objective function values.
     unsigned long time;         // Execution time.
+    unsigned long n_alloc;      // Buffers allocated during the iterations.
+};
+
+/*
+    This struct collects the reductions computed by the projection kernel.
+*/
+struct dstat_t {
+    double norm2 = 0;                   // Squared norm of the direction.
+    double gd = 0;                      // Product g^T * d.
+    bool changed = false;               // True if the active set changed.
+    double step = arma::datum::inf;     // Maximum feasible stepsize.
+};
+
+/*
+    This struct holds all the buffers used by the projected gradient method.
+    The buffers are sized once from the number of variables of the problem
+    and the length of the constraint list, so that the iterations of the
+    method run without allocating memory.
+    The buffers of the operator are sized at the first products, so the
+    first run may still allocate during its iterations (see n_alloc in
+    QResult). A workspace can be reused across several runs on problems
+    of the same size: in that case no allocation is performed at all.
+
+    Since the direction is zero on the active coordinates, a variable
+    that becomes active never moves again. The workspace keeps the list
+    of free variables of each block, which only shrinks during a run:
+    all the vector kernels work on these lists, and the gradient is only
+    kept up to date on the free coordinates.
+*/
+struct PGMWorkspace {
+    arma::vec x;                // Current point.
+    arma::vec g;                // Gradient at the current point.
+    arma::vec d;                // Projected direction.
+    arma::vec l;                // Product 2 * Q * d.
+    std::vector<cidx_t> free;   // Free variables of each block (as c.idx).
+    std::vector<cidx_t> nfree;  // Number of free variables of each block.
+    std::vector<cidx_t> supp;   // All the free variables (support of d).
+    size_t nsupp = 0;           // Number of free variables.
+    bool dirty = true;          // True if supp must be rebuilt.
+    std::vector<size_t> part;   // Groups of blocks assigned to the threads.
+    std::vector<size_t> fpart;  // Columns of Q assigned to the threads.
+    std::vector<size_t> spart;  // Positions of supp assigned to the threads.
+    std::vector<double> hist;   // History of the objective function values.
+
+    // Makes sure that the buffers can hold n variables and the
+    // free lists of the blocks of c.
+    void reserve(arma::uword n, const cstlist_t &c);
 };
 
 /*
@@ -36,37 +144,91 @@ struct QResult {
     the quadratic optimization problem. The class contains both
     the representation of the problem and the methods that can be used
     to solve it.
+    The type T of the Hessian also defines the precision of its entries
+    (e.g. arma::mat or arma::fmat): vectors are always stored in double
+    and all the products with Q are accumulated in double.
+    T can be any Hessian operator (see Operator.hpp), including a
+    matrix-free operator wrapped in op_t.
 */
 template <typename T>
 class QProblem {
+    static_assert(is_hessian<T>::value, "The Hessian type of QProblem does "
+    "not implement the Hessian operator concept (see Operator.hpp).");
+
 private:
     T Q;            // This is the Hessian matrix of the quadratic function.
     arma::vec q;    // This is the linear part.
     cstlist_t c;    // This is the list of constraints.
+    arma::uvec p;   // Permutation applied by reorder() (empty if none).
+    mapping_t aux;  // External memory viewed by Q or q (if any).
+    bool sorted = false;    // True if the indices of every block are sorted.
+    int nt = NUM_THREADS;   // Number of threads (0 = OpenMP default).
+
+    // Returns the number of threads to be used.
+    int threads();
+
+    // Checks that Q is n x n, where n is the number of variables.
+    void check_size();
+
+    // Performs a line search in the interval [0, alpha_bar],
+    // given the products g^T * d and d^T * l.
+    double line_search(double gd, double dl, double alpha_bar,
+    double eps = 1E-16);
+
+    // Computes the lists of free variables of the starting point.
+    void init_free(PGMWorkspace &ws, double ctol);
+
+    /*
+        Updates the active set, then computes the projected direction d,
+        its squared norm, the product g^T * d and the maximum feasible
+        stepsize in one call. All of them only involve the free variables.
+        The support of the direction is rebuilt if the active set changed.
+    */
+    dstat_t project(PGMWorkspace &ws, double ctol, double dtol);
 
-    // Computes the currently active constraints.
-    void set_active(const arma::vec &x, arma::uvec &act, double eps);
+    // Returns null if the list f of nf free variables is a contiguous
+    // range, so that the kernels can skip the gathers, and f otherwise.
+    // Only the lists of a reordered problem are sorted and checked.
+    const cidx_t *gathered(const cidx_t *f, cidx_t nf) {
+        return (sorted && nf > 0 && f[nf - 1] - f[0] + 1 == nf) ? nullptr : f;
+    }
 
-    // Computes the maximum feasible stepsize.
-    double max_step(const arma::vec &x, const arma::vec &d,
-    const arma::uvec &act, double eps);
+    // Applies the projection kernel to the b-th block.
+    void sub_proj(size_t b, PGMWorkspace &ws, double ctol, double dtol,
+    dstat_t &s);
 
-    // Performs a line search in the interval [0, alpha_bar].
-    double line_search(const arma::vec &g, const arma::vec &d,
-    const arma::vec &l, double alpha_bar, double eps = 1E-16);
+    // Objective function for a point in the internal ordering.
+    double obj(const arma::vec &x);
 
-    // Computes the projection of the gradient onto the subspace A_bar * d = 0.
-    arma::vec project(const arma::uvec &act, const arma::vec &g);
+    // Maps a vector from the original ordering to the internal one.
+    arma::vec to_internal(const arma::vec &x);
 
-    // Projects the gradient onto the single block of coordinates.
-    arma::vec sub_proj(const arma::vec &g, const arma::uvec &act);
+    // Maps a vector from the internal ordering to the original one.
+    arma::vec to_original(const arma::vec &x);
 
 public:
     // Default constructor.
     QProblem<T>() {};
 
-    // Main constructor.
-    QProblem<T>(T &Q, arma::vec &q, cstlist_t &c);
+    // Main constructor: Q, q and c are copied. Both constructors throw
+    // std::runtime_error if the size of Q does not match q.
+    QProblem<T>(const T &Q, const arma::vec &q, const cstlist_t &c);
+
+    /*
+        Builds the problem by moving Q, q and c, so that no copy is made.
+        Q and q may also be non-owning views over the memory of a mapped
+        file (see the auxiliary memory constructors of Armadillo): the
+        mapping aux is then kept alive as long as the problem.
+    */
+    QProblem<T>(T &&Q, arma::vec &&q, cstlist_t &&c,
+    mapping_t aux = mapping_t());
+
+    // Saves the problem into a binary container (see Binary.hpp).
+    // Only problems that have not been reordered can be saved.
+    void save(const std::string &path) const;
+
+    // Sets the number of threads used by the solver (0 = OpenMP default).
+    void set_threads(int nt) { this -> nt = nt; }
 
     // This is the objective function.
     double f(const arma::vec &x);
@@ -81,6 +243,17 @@ public:
     // of a partition S is equal to 1 / # of elements in S.
     arma::vec initial_point();
 
+    /*
+        Presolve stage that permutes the variables so that each block of
+        the constraint list occupies a contiguous range of indices, or
+        (for a sparse Q whose blocks are scattered, if RCM is set)
+        follows the RCM ordering of Q with sorted blocks.
+        The permutation is applied to Q, q and the constraint list:
+        all the public methods keep accepting and returning vectors in
+        the original ordering of the variables.
+    */
+    void reorder();
+
     /*
         This is the implementation of the projected gradient method.
         The following input parameters are required:
@@ -89,9 +262,15 @@ public:
             - max_iter, a limit on the number of iterations.
             - ctol, constraint tolerance.
             - dtol, norm tolerance.
+            - log, if true the value of the objective function is recorded
+              at each iteration.
     */
     QResult PGM(const arma::vec &x_0, arma::uword max_iter,
-    double ctol, double dtol);
+    double ctol, double dtol, bool log = false);
+
+    // Same as above, but runs the method inside a user-provided workspace.
+    QResult PGM(const arma::vec &x_0, arma::uword max_iter,
+    double ctol, double dtol, PGMWorkspace &ws, bool log = false);
 };
 
 // The actual implementation is defined in the file Problem.cpp.
@@ -0,0 +1,651 @@
+/*
+    File:       Simd.cpp
+    Authors:    Matteo Loporchio, Davide Rucci
+
+    Computational Mathematics for Learning and Data Analysis 2018/2019
+*/
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include "Simd.hpp"
+
+// The vectorized versions are only built by GCC on x86-64, where each
+// function can be compiled for a different instruction set.
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(__clang__)
+#define SIMD_X86 1
+#include <immintrin.h>
+#else
+#define SIMD_X86 0
+#endif
+
+namespace {
+
+const double INF = std::numeric_limits<double>::infinity();
+
+// Scalar versions of the kernels, used when no vector extension is available.
+namespace scalar {
+
+template<typename eT>
+double dot(const eT *a, const double *b, size_t n) {
+    double s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        s0 += a[i] * b[i];
+        s1 += a[i + 1] * b[i + 1];
+        s2 += a[i + 2] * b[i + 2];
+        s3 += a[i + 3] * b[i + 3];
+    }
+    for (; i < n; i++) s0 += a[i] * b[i];
+    return (s0 + s1) + (s2 + s3);
+}
+
+template<typename eT>
+void dot4(const eT *const *a, const double *b, size_t n, double *r) {
+    const eT *a0 = a[0], *a1 = a[1], *a2 = a[2], *a3 = a[3];
+    double s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    for (size_t i = 0; i < n; i++) {
+        s0 += a0[i] * b[i];
+        s1 += a1[i] * b[i];
+        s2 += a2[i] * b[i];
+        s3 += a3[i] * b[i];
+    }
+    r[0] = s0; r[1] = s1; r[2] = s2; r[3] = s3;
+}
+
+template<typename eT>
+double dot_axpy(const eT *a, const double *b, double *y, double alpha,
+size_t n) {
+    double s = 0;
+    for (size_t i = 0; i < n; i++) {
+        s += a[i] * b[i];
+        y[i] += a[i] * alpha;
+    }
+    return s;
+}
+
+template<typename eT>
+double dot_idx(const eT *a, const double *b, const cidx_t *idx, size_t n) {
+    double s0 = 0, s1 = 0;
+    size_t j = 0;
+    for (; j + 2 <= n; j += 2) {
+        s0 += a[idx[j]] * b[idx[j]];
+        s1 += a[idx[j + 1]] * b[idx[j + 1]];
+    }
+    if (j < n) s0 += a[idx[j]] * b[idx[j]];
+    return s0 + s1;
+}
+
+template<typename eT>
+void sell8(const eT *a, const cidx_t *col, size_t w, const double *x,
+double *r) {
+    for (size_t k = 0; k < 8; k++) r[k] = 0;
+    for (size_t j = 0; j < w; j++, a += 8, col += 8) {
+        for (size_t k = 0; k < 8; k++) r[k] += a[k] * x[col[k]];
+    }
+}
+
+template<typename eT>
+void bcsr4(const eT *a, const cidx_t *col, size_t nb, const double *x,
+double *r) {
+    double r0 = 0, r1 = 0, r2 = 0, r3 = 0;
+    for (size_t b = 0; b < nb; b++, a += 4) {
+        double xb = x[col[b]];
+        r0 += a[0] * xb;
+        r1 += a[1] * xb;
+        r2 += a[2] * xb;
+        r3 += a[3] * xb;
+    }
+    r[0] = r0; r[1] = r1; r[2] = r2; r[3] = r3;
+}
+
+double sum(const double *g, const cidx_t *idx, size_t lo, size_t n) {
+    double s = 0;
+    for (size_t j = 0; j < n; j++) s += g[(idx) ? idx[j] : lo + j];
+    return s;
+}
+
+void direction(const cidx_t *idx, size_t lo, size_t n, double m,
+const double *x, const double *g, double *d, double dtol, double &norm2,
+double &gd, double &step) {
+    for (size_t j = 0; j < n; j++) {
+        size_t i = (idx) ? idx[j] : lo + j;
+        double di = m - g[i];
+        d[i] = di;
+        norm2 += di * di;
+        gd += g[i] * di;
+        if (-di > dtol) step = fmin(step, -x[i] / di);
+    }
+}
+
+void update(const cidx_t *idx, size_t lo, size_t n, double alpha,
+const double *d, const double *l, double *x, double *g) {
+    for (size_t j = 0; j < n; j++) {
+        size_t i = (idx) ? idx[j] : lo + j;
+        x[i] += alpha * d[i];
+        g[i] += alpha * l[i];
+    }
+}
+
+}
+
+#if SIMD_X86
+
+// AVX2 versions: 4 doubles per register, gathers but no scatters.
+#pragma GCC push_options
+#pragma GCC target("avx2,fma")
+namespace avx2 {
+
+inline __m256d load(const double *p) { return _mm256_loadu_pd(p); }
+inline __m256d load(const float *p) { return _mm256_cvtps_pd(_mm_loadu_ps(p)); }
+
+// Loads 4 indices, widened to 64 bits.
+inline __m256i load_idx(const cidx_t *p) {
+#if CST_IDX_32
+    return _mm256_cvtepu32_epi64(_mm_loadu_si128((const __m128i *) p));
+#else
+    return _mm256_loadu_si256((const __m256i *) p);
+#endif
+}
+
+inline __m256d gather(const double *p, __m256i j) {
+    return _mm256_i64gather_pd(p, j, 8);
+}
+
+inline __m256d gather(const float *p, __m256i j) {
+    return _mm256_cvtps_pd(_mm256_i64gather_ps(p, j, 4));
+}
+
+inline void scatter(double *p, const cidx_t *idx, __m256d v) {
+    alignas(32) double t[4];
+    _mm256_store_pd(t, v);
+    p[idx[0]] = t[0]; p[idx[1]] = t[1]; p[idx[2]] = t[2]; p[idx[3]] = t[3];
+}
+
+inline double hsum(__m256d v) {
+    __m128d s = _mm_add_pd(_mm256_castpd256_pd128(v),
+        _mm256_extractf128_pd(v, 1));
+    return _mm_cvtsd_f64(_mm_add_sd(s, _mm_unpackhi_pd(s, s)));
+}
+
+inline double hmin(__m256d v) {
+    __m128d s = _mm_min_pd(_mm256_castpd256_pd128(v),
+        _mm256_extractf128_pd(v, 1));
+    return _mm_cvtsd_f64(_mm_min_sd(s, _mm_unpackhi_pd(s, s)));
+}
+
+template<typename eT>
+double dot(const eT *a, const double *b, size_t n) {
+    __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        s0 = _mm256_fmadd_pd(load(a + i), load(b + i), s0);
+        s1 = _mm256_fmadd_pd(load(a + i + 4), load(b + i + 4), s1);
+    }
+    double s = hsum(_mm256_add_pd(s0, s1));
+    for (; i < n; i++) s += a[i] * b[i];
+    return s;
+}
+
+template<typename eT>
+void dot4(const eT *const *a, const double *b, size_t n, double *r) {
+    const eT *a0 = a[0], *a1 = a[1], *a2 = a[2], *a3 = a[3];
+    __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+    __m256d s2 = _mm256_setzero_pd(), s3 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d bi = load(b + i);
+        s0 = _mm256_fmadd_pd(load(a0 + i), bi, s0);
+        s1 = _mm256_fmadd_pd(load(a1 + i), bi, s1);
+        s2 = _mm256_fmadd_pd(load(a2 + i), bi, s2);
+        s3 = _mm256_fmadd_pd(load(a3 + i), bi, s3);
+    }
+    r[0] = hsum(s0); r[1] = hsum(s1); r[2] = hsum(s2); r[3] = hsum(s3);
+    for (; i < n; i++) {
+        r[0] += a0[i] * b[i];
+        r[1] += a1[i] * b[i];
+        r[2] += a2[i] * b[i];
+        r[3] += a3[i] * b[i];
+    }
+}
+
+template<typename eT>
+double dot_axpy(const eT *a, const double *b, double *y, double alpha,
+size_t n) {
+    __m256d s = _mm256_setzero_pd(), va = _mm256_set1_pd(alpha);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d ai = load(a + i);
+        s = _mm256_fmadd_pd(ai, load(b + i), s);
+        _mm256_storeu_pd(y + i, _mm256_fmadd_pd(ai, va, load(y + i)));
+    }
+    double r = hsum(s);
+    for (; i < n; i++) {
+        r += a[i] * b[i];
+        y[i] += a[i] * alpha;
+    }
+    return r;
+}
+
+template<typename eT>
+double dot_idx(const eT *a, const double *b, const cidx_t *idx, size_t n) {
+    __m256d s = _mm256_setzero_pd();
+    size_t j = 0;
+    for (; j + 4 <= n; j += 4) {
+        __m256i vj = load_idx(idx + j);
+        s = _mm256_fmadd_pd(gather(a, vj), gather(b, vj), s);
+    }
+    double r = hsum(s);
+    for (; j < n; j++) r += a[idx[j]] * b[idx[j]];
+    return r;
+}
+
+template<typename eT>
+void sell8(const eT *a, const cidx_t *col, size_t w, const double *x,
+double *r) {
+    __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+    for (size_t j = 0; j < w; j++, a += 8, col += 8) {
+        s0 = _mm256_fmadd_pd(load(a), gather(x, load_idx(col)), s0);
+        s1 = _mm256_fmadd_pd(load(a + 4), gather(x, load_idx(col + 4)), s1);
+    }
+    _mm256_storeu_pd(r, s0);
+    _mm256_storeu_pd(r + 4, s1);
+}
+
+template<typename eT>
+void bcsr4(const eT *a, const cidx_t *col, size_t nb, const double *x,
+double *r) {
+    __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+    size_t b = 0;
+    for (; b + 2 <= nb; b += 2) {
+        s0 = _mm256_fmadd_pd(load(a + 4 * b), _mm256_set1_pd(x[col[b]]), s0);
+        s1 = _mm256_fmadd_pd(load(a + 4 * b + 4),
+            _mm256_set1_pd(x[col[b + 1]]), s1);
+    }
+    if (b < nb) {
+        s0 = _mm256_fmadd_pd(load(a + 4 * b), _mm256_set1_pd(x[col[b]]), s0);
+    }
+    _mm256_storeu_pd(r, _mm256_add_pd(s0, s1));
+}
+
+double sum(const double *g, const cidx_t *idx, size_t lo, size_t n) {
+    __m256d s = _mm256_setzero_pd();
+    size_t j = 0;
+    for (; j + 4 <= n; j += 4) {
+        s = _mm256_add_pd(s, (idx) ? gather(g, load_idx(idx + j)) :
+            load(g + lo + j));
+    }
+    return hsum(s) + scalar::sum(g, (idx) ? idx + j : idx, lo + j, n - j);
+}
+
+void direction(const cidx_t *idx, size_t lo, size_t n, double m,
+const double *x, const double *g, double *d, double dtol, double &norm2,
+double &gd, double &step) {
+    __m256d vm = _mm256_set1_pd(m), vt = _mm256_set1_pd(-dtol);
+    __m256d vinf = _mm256_set1_pd(INF), zero = _mm256_setzero_pd();
+    __m256d sn = zero, sg = zero, ss = vinf;
+    size_t j = 0;
+    for (; j + 4 <= n; j += 4) {
+        __m256d gi, xi;
+        if (idx) {
+            __m256i vj = load_idx(idx + j);
+            gi = gather(g, vj);
+            xi = gather(x, vj);
+        }
+        else {
+            gi = load(g + lo + j);
+            xi = load(x + lo + j);
+        }
+        __m256d di = _mm256_sub_pd(vm, gi);
+        if (idx) scatter(d, idx + j, di);
+        else _mm256_storeu_pd(d + lo + j, di);
+        sn = _mm256_fmadd_pd(di, di, sn);
+        sg = _mm256_fmadd_pd(gi, di, sg);
+        // Ratio test on the lanes with d(i) < -dtol.
+        __m256d r = _mm256_div_pd(_mm256_sub_pd(zero, xi), di);
+        __m256d mask = _mm256_cmp_pd(di, vt, _CMP_LT_OQ);
+        ss = _mm256_min_pd(ss, _mm256_blendv_pd(vinf, r, mask));
+    }
+    norm2 += hsum(sn);
+    gd += hsum(sg);
+    step = fmin(step, hmin(ss));
+    scalar::direction((idx) ? idx + j : idx, lo + j, n - j, m, x, g, d, dtol,
+        norm2, gd, step);
+}
+
+void update(const cidx_t *idx, size_t lo, size_t n, double alpha,
+const double *d, const double *l, double *x, double *g) {
+    __m256d va = _mm256_set1_pd(alpha);
+    size_t j = 0;
+    for (; j + 4 <= n; j += 4) {
+        if (idx) {
+            __m256i vj = load_idx(idx + j);
+            scatter(x, idx + j,
+                _mm256_fmadd_pd(va, gather(d, vj), gather(x, vj)));
+            scatter(g, idx + j,
+                _mm256_fmadd_pd(va, gather(l, vj), gather(g, vj)));
+        }
+        else {
+            size_t i = lo + j;
+            _mm256_storeu_pd(x + i, _mm256_fmadd_pd(va, load(d + i), load(x + i)));
+            _mm256_storeu_pd(g + i, _mm256_fmadd_pd(va, load(l + i), load(g + i)));
+        }
+    }
+    scalar::update((idx) ? idx + j : idx, lo + j, n - j, alpha, d, l, x, g);
+}
+
+}
+#pragma GCC pop_options
+
+// AVX-512 versions: 8 doubles per register, with gathers and scatters.
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+namespace avx512 {
+
+inline __m512d load(const double *p) { return _mm512_loadu_pd(p); }
+inline __m512d load(const float *p) { return _mm512_cvtps_pd(_mm256_loadu_ps(p)); }
+
+// Loads 8 indices, widened to 64 bits.
+inline __m512i load_idx(const cidx_t *p) {
+#if CST_IDX_32
+    return _mm512_cvtepu32_epi64(_mm256_loadu_si256((const __m256i *) p));
+#else
+    return _mm512_loadu_si512(p);
+#endif
+}
+
+inline __m512d gather(const double *p, __m512i j) {
+    return _mm512_i64gather_pd(j, p, 8);
+}
+
+inline __m512d gather(const float *p, __m512i j) {
+    return _mm512_cvtps_pd(_mm512_i64gather_ps(j, p, 4));
+}
+
+inline void scatter(double *p, __m512i j, __m512d v) {
+    _mm512_i64scatter_pd(p, j, v, 8);
+}
+
+template<typename eT>
+double dot(const eT *a, const double *b, size_t n) {
+    __m512d s0 = _mm512_setzero_pd(), s1 = _mm512_setzero_pd();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        s0 = _mm512_fmadd_pd(load(a + i), load(b + i), s0);
+        s1 = _mm512_fmadd_pd(load(a + i + 8), load(b + i + 8), s1);
+    }
+    double s = _mm512_reduce_add_pd(_mm512_add_pd(s0, s1));
+    for (; i < n; i++) s += a[i] * b[i];
+    return s;
+}
+
+template<typename eT>
+void dot4(const eT *const *a, const double *b, size_t n, double *r) {
+    const eT *a0 = a[0], *a1 = a[1], *a2 = a[2], *a3 = a[3];
+    __m512d s0 = _mm512_setzero_pd(), s1 = _mm512_setzero_pd();
+    __m512d s2 = _mm512_setzero_pd(), s3 = _mm512_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m512d bi = load(b + i);
+        s0 = _mm512_fmadd_pd(load(a0 + i), bi, s0);
+        s1 = _mm512_fmadd_pd(load(a1 + i), bi, s1);
+        s2 = _mm512_fmadd_pd(load(a2 + i), bi, s2);
+        s3 = _mm512_fmadd_pd(load(a3 + i), bi, s3);
+    }
+    r[0] = _mm512_reduce_add_pd(s0);
+    r[1] = _mm512_reduce_add_pd(s1);
+    r[2] = _mm512_reduce_add_pd(s2);
+    r[3] = _mm512_reduce_add_pd(s3);
+    for (; i < n; i++) {
+        r[0] += a0[i] * b[i];
+        r[1] += a1[i] * b[i];
+        r[2] += a2[i] * b[i];
+        r[3] += a3[i] * b[i];
+    }
+}
+
+template<typename eT>
+double dot_axpy(const eT *a, const double *b, double *y, double alpha,
+size_t n) {
+    __m512d s = _mm512_setzero_pd(), va = _mm512_set1_pd(alpha);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m512d ai = load(a + i);
+        s = _mm512_fmadd_pd(ai, load(b + i), s);
+        _mm512_storeu_pd(y + i, _mm512_fmadd_pd(ai, va, load(y + i)));
+    }
+    double r = _mm512_reduce_add_pd(s);
+    for (; i < n; i++) {
+        r += a[i] * b[i];
+        y[i] += a[i] * alpha;
+    }
+    return r;
+}
+
+template<typename eT>
+double dot_idx(const eT *a, const double *b, const cidx_t *idx, size_t n) {
+    __m512d s = _mm512_setzero_pd();
+    size_t j = 0;
+    for (; j + 8 <= n; j += 8) {
+        __m512i vj = load_idx(idx + j);
+        s = _mm512_fmadd_pd(gather(a, vj), gather(b, vj), s);
+    }
+    double r = _mm512_reduce_add_pd(s);
+    for (; j < n; j++) r += a[idx[j]] * b[idx[j]];
+    return r;
+}
+
+template<typename eT>
+void sell8(const eT *a, const cidx_t *col, size_t w, const double *x,
+double *r) {
+    __m512d s = _mm512_setzero_pd();
+    for (size_t j = 0; j < w; j++, a += 8, col += 8) {
+        s = _mm512_fmadd_pd(load(a), gather(x, load_idx(col)), s);
+    }
+    _mm512_storeu_pd(r, s);
+}
+
+// The blocks of BCSR only fill half of a register: the AVX2 version is used.
+using avx2::bcsr4;
+
+double sum(const double *g, const cidx_t *idx, size_t lo, size_t n) {
+    __m512d s = _mm512_setzero_pd();
+    size_t j = 0;
+    for (; j + 8 <= n; j += 8) {
+        s = _mm512_add_pd(s, (idx) ? gather(g, load_idx(idx + j)) :
+            load(g + lo + j));
+    }
+    return _mm512_reduce_add_pd(s) +
+        scalar::sum(g, (idx) ? idx + j : idx, lo + j, n - j);
+}
+
+void direction(const cidx_t *idx, size_t lo, size_t n, double m,
+const double *x, const double *g, double *d, double dtol, double &norm2,
+double &gd, double &step) {
+    __m512d vm = _mm512_set1_pd(m), vt = _mm512_set1_pd(-dtol);
+    __m512d zero = _mm512_setzero_pd();
+    __m512d sn = zero, sg = zero, ss = _mm512_set1_pd(INF);
+    size_t j = 0;
+    for (; j + 8 <= n; j += 8) {
+        __m512i vj;
+        __m512d gi, xi;
+        if (idx) {
+            vj = load_idx(idx + j);
+            gi = gather(g, vj);
+            xi = gather(x, vj);
+        }
+        else {
+            gi = load(g + lo + j);
+            xi = load(x + lo + j);
+        }
+        __m512d di = _mm512_sub_pd(vm, gi);
+        if (idx) scatter(d, vj, di);
+        else _mm512_storeu_pd(d + lo + j, di);
+        sn = _mm512_fmadd_pd(di, di, sn);
+        sg = _mm512_fmadd_pd(gi, di, sg);
+        // Ratio test on the lanes with d(i) < -dtol.
+        __mmask8 k = _mm512_cmp_pd_mask(di, vt, _CMP_LT_OQ);
+        ss = _mm512_mask_min_pd(ss, k, ss,
+            _mm512_div_pd(_mm512_sub_pd(zero, xi), di));
+    }
+    norm2 += _mm512_reduce_add_pd(sn);
+    gd += _mm512_reduce_add_pd(sg);
+    step = fmin(step, _mm512_reduce_min_pd(ss));
+    scalar::direction((idx) ? idx + j : idx, lo + j, n - j, m, x, g, d, dtol,
+        norm2, gd, step);
+}
+
+void update(const cidx_t *idx, size_t lo, size_t n, double alpha,
+const double *d, const double *l, double *x, double *g) {
+    __m512d va = _mm512_set1_pd(alpha);
+    size_t j = 0;
+    for (; j + 8 <= n; j += 8) {
+        if (idx) {
+            __m512i vj = load_idx(idx + j);
+            scatter(x, vj, _mm512_fmadd_pd(va, gather(d, vj), gather(x, vj)));
+            scatter(g, vj, _mm512_fmadd_pd(va, gather(l, vj), gather(g, vj)));
+        }
+        else {
+            size_t i = lo + j;
+            _mm512_storeu_pd(x + i, _mm512_fmadd_pd(va, load(d + i), load(x + i)));
+            _mm512_storeu_pd(g + i, _mm512_fmadd_pd(va, load(l + i), load(g + i)));
+        }
+    }
+    scalar::update((idx) ? idx + j : idx, lo + j, n - j, alpha, d, l, x, g);
+}
+
+}
+#pragma GCC pop_options
+
+#endif
+
+// Table with the kernels of an instruction set.
+struct simd_ops {
+    const char *name;
+    double (*dot_d)(const double *, const double *, size_t);
+    double (*dot_f)(const float *, const double *, size_t);
+    void (*dot4_d)(const double *const *, const double *, size_t, double *);
+    void (*dot4_f)(const float *const *, const double *, size_t, double *);
+    double (*dot_axpy_d)(const double *, const double *, double *, double,
+        size_t);
+    double (*dot_axpy_f)(const float *, const double *, double *, double,
+        size_t);
+    double (*dot_idx_d)(const double *, const double *, const cidx_t *, size_t);
+    double (*dot_idx_f)(const float *, const double *, const cidx_t *, size_t);
+    void (*sell8_d)(const double *, const cidx_t *, size_t, const double *,
+        double *);
+    void (*sell8_f)(const float *, const cidx_t *, size_t, const double *,
+        double *);
+    void (*bcsr4_d)(const double *, const cidx_t *, size_t, const double *,
+        double *);
+    void (*bcsr4_f)(const float *, const cidx_t *, size_t, const double *,
+        double *);
+    double (*sum)(const double *, const cidx_t *, size_t, size_t);
+    void (*direction)(const cidx_t *, size_t, size_t, double, const double *,
+        const double *, double *, double, double &, double &, double &);
+    void (*update)(const cidx_t *, size_t, size_t, double, const double *,
+        const double *, double *, double *);
+};
+
+#define SIMD_OPS(ns) { #ns, ns::dot<double>, ns::dot<float>, \
+    ns::dot4<double>, ns::dot4<float>, ns::dot_axpy<double>, \
+    ns::dot_axpy<float>, ns::dot_idx<double>, ns::dot_idx<float>, \
+    ns::sell8<double>, ns::sell8<float>, ns::bcsr4<double>, \
+    ns::bcsr4<float>, ns::sum, ns::direction, ns::update }
+
+// Selects the widest instruction set supported by the CPU (and allowed
+// by the QP_SIMD environment variable).
+simd_ops select_ops() {
+#if SIMD_X86
+    const char *env = getenv("QP_SIMD");
+    __builtin_cpu_init();
+    bool has2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    bool has512 = has2 && __builtin_cpu_supports("avx512f");
+    if (env && !strcmp(env, "scalar")) has512 = has2 = false;
+    if (env && !strcmp(env, "avx2")) has512 = false;
+    if (has512) return SIMD_OPS(avx512);
+    if (has2) return SIMD_OPS(avx2);
+#endif
+    return SIMD_OPS(scalar);
+}
+
+const simd_ops &ops() {
+    static const simd_ops o = select_ops();
+    return o;
+}
+
+}
+
+double vdot(const double *a, const double *b, size_t n) {
+    return ops().dot_d(a, b, n);
+}
+
+double vdot(const float *a, const double *b, size_t n) {
+    return ops().dot_f(a, b, n);
+}
+
+void vdot4(const double *const *a, const double *b, size_t n, double *r) {
+    ops().dot4_d(a, b, n, r);
+}
+
+void vdot4(const float *const *a, const double *b, size_t n, double *r) {
+    ops().dot4_f(a, b, n, r);
+}
+
+double vdot_axpy(const double *a, const double *b, double *y, double alpha,
+size_t n) {
+    return ops().dot_axpy_d(a, b, y, alpha, n);
+}
+
+double vdot_axpy(const float *a, const double *b, double *y, double alpha,
+size_t n) {
+    return ops().dot_axpy_f(a, b, y, alpha, n);
+}
+
+double vdot_idx(const double *a, const double *b, const cidx_t *idx, size_t n) {
+    return ops().dot_idx_d(a, b, idx, n);
+}
+
+double vdot_idx(const float *a, const double *b, const cidx_t *idx, size_t n) {
+    return ops().dot_idx_f(a, b, idx, n);
+}
+
+void vsell8(const double *a, const cidx_t *col, size_t w, const double *x,
+double *r) {
+    ops().sell8_d(a, col, w, x, r);
+}
+
+void vsell8(const float *a, const cidx_t *col, size_t w, const double *x,
+double *r) {
+    ops().sell8_f(a, col, w, x, r);
+}
+
+void vbcsr4(const double *a, const cidx_t *col, size_t nb, const double *x,
+double *r) {
+    ops().bcsr4_d(a, col, nb, x, r);
+}
+
+void vbcsr4(const float *a, const cidx_t *col, size_t nb, const double *x,
+double *r) {
+    ops().bcsr4_f(a, col, nb, x, r);
+}
+
+double vsum(const double *g, const cidx_t *idx, size_t lo, size_t n) {
+    return ops().sum(g, idx, lo, n);
+}
+
+void vdirection(const cidx_t *idx, size_t lo, size_t n, double m,
+const double *x, const double *g, double *d, double dtol, double &norm2,
+double &gd, double &step) {
+    ops().direction(idx, lo, n, m, x, g, d, dtol, norm2, gd, step);
+}
+
+void vupdate(const cidx_t *idx, size_t lo, size_t n, double alpha,
+const double *d, const double *l, double *x, double *g) {
+    ops().update(idx, lo, n, alpha, d, l, x, g);
+}
+
+const char *simd_name() {
+    return ops().name;
+}
@@ -0,0 +1,82 @@
+/*
+    File:       Simd.hpp
+    Authors:    Matteo Loporchio, Davide Rucci
+
+    Computational Mathematics for Learning and Data Analysis 2018/2019
+*/
+
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <cstddef>
+#include "Config.hpp"
+
+/*
+    Vectorized kernels used by the solver. Each kernel comes in a scalar,
+    an AVX2 and an AVX-512 version: the best one supported by the CPU is
+    selected at run time, the first time any kernel is called, so that the
+    same executable runs on every x86-64 machine without an external BLAS.
+    The choice can be forced with the QP_SIMD environment variable
+    (scalar, avx2 or avx512). Vectors are always in double precision,
+    while the matrix entries can be in double or single precision.
+
+    The kernels over a list of coordinates take the list in idx: if idx is
+    null, the coordinates are the contiguous range [lo, lo + n), which is
+    the case of the blocks made contiguous by the reordering.
+*/
+
+// Returns the dot product between a and b, accumulated in double.
+double vdot(const double *a, const double *b, size_t n);
+double vdot(const float *a, const double *b, size_t n);
+
+// Computes the four dot products r[k] = a[k]^T * b, sharing the loads of b
+// (register-blocked kernel of the dense matrix-vector products).
+void vdot4(const double *const *a, const double *b, size_t n, double *r);
+void vdot4(const float *const *a, const double *b, size_t n, double *r);
+
+// Returns the dot product between a and b and performs y = y + alpha * a
+// in the same pass (kernel of the symmetric matrix-vector products).
+double vdot_axpy(const double *a, const double *b, double *y, double alpha,
+size_t n);
+double vdot_axpy(const float *a, const double *b, double *y, double alpha,
+size_t n);
+
+// Returns the dot product between a and b restricted to the n coordinates
+// listed in idx.
+double vdot_idx(const double *a, const double *b, const cidx_t *idx, size_t n);
+double vdot_idx(const float *a, const double *b, const cidx_t *idx, size_t n);
+
+// Computes r[k] = sum_j a[8 * j + k] * x[col[8 * j + k]], k = 0, ..., 7,
+// over the w columns of a chunk of 8 rows of a SELL matrix.
+void vsell8(const double *a, const cidx_t *col, size_t w, const double *x,
+double *r);
+void vsell8(const float *a, const cidx_t *col, size_t w, const double *x,
+double *r);
+
+// Computes r[k] = sum_b a[4 * b + k] * x[col[b]], k = 0, ..., 3,
+// over the nb blocks of a block row of a BCSR matrix with 4 x 1 blocks.
+void vbcsr4(const double *a, const cidx_t *col, size_t nb, const double *x,
+double *r);
+void vbcsr4(const float *a, const cidx_t *col, size_t nb, const double *x,
+double *r);
+
+// Returns the sum of the entries of g on the listed coordinates.
+double vsum(const double *g, const cidx_t *idx, size_t lo, size_t n);
+
+/*
+    Projection kernel: on the listed coordinates, sets d = m - g and
+    accumulates ||d||^2 into norm2, g^T * d into gd and the minimum of
+    -x(i) / d(i) over the coordinates with -d(i) > dtol into step.
+*/
+void vdirection(const cidx_t *idx, size_t lo, size_t n, double m,
+const double *x, const double *g, double *d, double dtol, double &norm2,
+double &gd, double &step);
+
+// Performs x = x + alpha * d and g = g + alpha * l on the listed coordinates.
+void vupdate(const cidx_t *idx, size_t lo, size_t n, double alpha,
+const double *d, const double *l, double *x, double *g);
+
+// Returns the name of the instruction set used by the kernels.
+const char *simd_name();
+
+#endif
@@ -0,0 +1,207 @@
+/*
+    File:       SpFormats.cpp
+    Authors:    Matteo Loporchio, Davide Rucci
+
+    Computational Mathematics for Learning and Data Analysis 2018/2019
+*/
+
+#ifndef SPFORMATS_IMPL_
+#define SPFORMATS_IMPL_
+
+#include <algorithm>
+#include <numeric>
+#include "SpFormats.hpp"
+
+// Maximum ratio between the entries stored by BCSR and the nonzeros.
+const double BCSR_MAX_FILL = 1.5;
+
+// Maximum ratio between the entries stored by SELL-C-sigma (padding
+// included) and the nonzeros.
+const double SELL_MAX_FILL = 1.3;
+
+// SELL-C-sigma is only chosen if 90% of the rows are at most this long.
+const size_t SELL_MAX_LEN = 64;
+
+/*
+    Computes the SELL-C-sigma layout of a matrix whose rows have the given
+    lengths: the row stored in each slot (perm, padded with n to a multiple
+    of SELL_C) and the offsets of the entries of each chunk (cptr).
+*/
+inline void sell_layout(const std::vector<size_t> &len,
+std::vector<cidx_t> &perm, std::vector<size_t> &cptr) {
+    size_t n = len.size(), nc = (n + SELL_C - 1) / SELL_C;
+    perm.assign(nc * SELL_C, (cidx_t) n);
+    std::iota(perm.begin(), perm.begin() + n, (cidx_t) 0);
+    for (size_t lo = 0; lo < n; lo += SELL_SIGMA) {
+        size_t hi = std::min(lo + SELL_SIGMA, n);
+        std::stable_sort(perm.begin() + lo, perm.begin() + hi,
+        [&](cidx_t a, cidx_t b) { return len[a] > len[b]; });
+    }
+    cptr.assign(nc + 1, 0);
+    for (size_t k = 0; k < nc; k++) {
+        size_t w = 0;
+        for (size_t s = k * SELL_C; s < (k + 1) * SELL_C; s++) {
+            if (perm[s] < n) w = std::max(w, len[perm[s]]);
+        }
+        cptr[k + 1] = cptr[k] + w * SELL_C;
+    }
+}
+
+// Builds the SELL-C-sigma representation of a sparse symmetric matrix.
+template<typename eT>
+void build_sell(const arma::SpMat<eT> &A, sellmat_t<eT> &B) {
+    A.sync();
+    const arma::uword *cp = A.col_ptrs, *ri = A.row_indices;
+    const eT *v = A.values;
+    size_t n = A.n_cols;
+    std::vector<size_t> len(n);
+    for (size_t i = 0; i < n; i++) len[i] = cp[i + 1] - cp[i];
+    B.n_rows = A.n_rows;
+    B.n_cols = A.n_cols;
+    sell_layout(len, B.perm, B.cptr);
+    B.pos.resize(n);
+    B.col.assign(B.cptr.back(), 0);
+    B.val.zeros(B.cptr.back());
+    for (size_t s = 0; s < B.perm.size(); s++) {
+        size_t i = B.perm[s];
+        if (i >= n) continue;
+        B.pos[i] = (cidx_t) s;
+        size_t p = B.cptr[s / SELL_C] + s % SELL_C;
+        for (size_t j = 0; j < len[i]; j++) {
+            B.col[p + j * SELL_C] = (cidx_t) ri[cp[i] + j];
+            B.val[p + j * SELL_C] = v[cp[i] + j];
+        }
+    }
+}
+
+// Builds the BCSR representation of a sparse symmetric matrix.
+template<typename eT>
+void build_bcsr(const arma::SpMat<eT> &A, bcsrmat_t<eT> &B) {
+    A.sync();
+    const arma::uword *cp = A.col_ptrs, *ri = A.row_indices;
+    const eT *v = A.values;
+    size_t n = A.n_cols, nb = (n + BCSR_R - 1) / BCSR_R;
+    B.n_rows = A.n_rows;
+    B.n_cols = A.n_cols;
+    B.bptr.assign(nb + 1, 0);
+    B.col.clear();
+    std::vector<eT> val;
+    // Block of each column in the current block row (if mark[c] == br).
+    std::vector<size_t> mark(A.n_rows, nb), slot(A.n_rows);
+    for (size_t br = 0; br < nb; br++) {
+        for (size_t i = br * BCSR_R; i < std::min((br + 1) * BCSR_R, n); i++) {
+            for (arma::uword k = cp[i]; k < cp[i + 1]; k++) {
+                arma::uword c = ri[k];
+                if (mark[c] != br) {
+                    mark[c] = br;
+                    slot[c] = B.col.size();
+                    B.col.push_back((cidx_t) c);
+                    val.resize(val.size() + BCSR_R, 0);
+                }
+                val[slot[c] * BCSR_R + i % BCSR_R] = v[k];
+            }
+        }
+        B.bptr[br + 1] = B.col.size();
+    }
+    B.val = arma::Col<eT>(val);
+}
+
+// Chooses the format of a sparse symmetric matrix.
+template<typename eT>
+spformat_t select_format(const arma::SpMat<eT> &A) {
+    A.sync();
+    const arma::uword *cp = A.col_ptrs, *ri = A.row_indices;
+    size_t n = A.n_cols, nnz = A.n_nonzero;
+    if (n == 0 || nnz == 0) return SP_CSC;
+    // Histogram of the lengths of the rows.
+    std::vector<size_t> len(n), hist;
+    for (size_t i = 0; i < n; i++) {
+        len[i] = cp[i + 1] - cp[i];
+        if (len[i] >= hist.size()) hist.resize(len[i] + 1, 0);
+        hist[len[i]]++;
+    }
+    // Number of blocks of BCSR, counted as in build_bcsr.
+    size_t nb = (n + BCSR_R - 1) / BCSR_R, blocks = 0;
+    std::vector<size_t> mark(A.n_rows, nb);
+    for (size_t i = 0; i < n; i++) {
+        for (arma::uword k = cp[i]; k < cp[i + 1]; k++) {
+            if (mark[ri[k]] != i / BCSR_R) { mark[ri[k]] = i / BCSR_R; blocks++; }
+        }
+    }
+    if (blocks * BCSR_R <= BCSR_MAX_FILL * nnz) return SP_BCSR;
+    // Length below which 90% of the rows fall, and padding of SELL.
+    size_t p90 = 0;
+    for (size_t acc = hist[0]; 10 * acc < 9 * n; acc += hist[++p90]);
+    std::vector<cidx_t> perm;
+    std::vector<size_t> cptr;
+    sell_layout(len, perm, cptr);
+    if (p90 <= SELL_MAX_LEN && cptr.back() <= SELL_MAX_FILL * nnz) {
+        return SP_SELL;
+    }
+    return SP_CSC;
+}
+
+// Chooses the format of A (unless forced by SP_FORMAT) and stores it.
+template<typename eT>
+void spauto_t<eT>::set(arma::SpMat<eT> A) {
+    n_rows = A.n_rows;
+    n_cols = A.n_cols;
+    n_nonzero = A.n_nonzero;
+    format = (SP_FORMAT >= 0) ? (spformat_t) SP_FORMAT : select_format(A);
+    S.reset();
+    sell = sellmat_t<eT>();
+    bcsr = bcsrmat_t<eT>();
+    switch (format) {
+        case SP_SELL: build_sell(A, sell); break;
+        case SP_BCSR: build_bcsr(A, bcsr); break;
+        default: S = std::move(A); break;
+    }
+}
+
+// Returns the matrix in CSC format.
+template<typename eT>
+arma::SpMat<eT> spauto_t<eT>::to_spmat() const {
+    if (format == SP_CSC) return S;
+    // Collect the nonzero entries: row i holds the entries of column i.
+    std::vector<arma::uword> loc;
+    std::vector<eT> val;
+    auto add = [&](arma::uword r, arma::uword c, eT v) {
+        if (v == 0) return;
+        loc.push_back(r);
+        loc.push_back(c);
+        val.push_back(v);
+    };
+    if (format == SP_SELL) {
+        for (size_t s = 0; s < sell.perm.size(); s++) {
+            size_t i = sell.perm[s], k = s / SELL_C;
+            if (i >= n_cols) continue;
+            for (size_t j = 0; j < sell.width(k); j++) {
+                size_t p = sell.cptr[k] + s % SELL_C + j * SELL_C;
+                add(sell.col[p], i, sell.val[p]);
+            }
+        }
+    }
+    else {
+        for (size_t br = 0; br + 1 < bcsr.bptr.size(); br++) {
+            for (size_t b = bcsr.bptr[br]; b < bcsr.bptr[br + 1]; b++) {
+                for (size_t r = 0; r < BCSR_R; r++) {
+                    add(bcsr.col[b], br * BCSR_R + r, bcsr.val[b * BCSR_R + r]);
+                }
+            }
+        }
+    }
+    arma::umat L(loc.data(), 2, val.size(), false, true);
+    arma::Col<eT> V(val.data(), val.size(), false, true);
+    return arma::SpMat<eT>(L, V, n_rows, n_cols);
+}
+
+// Returns the name of a sparse format.
+inline const char *format_name(spformat_t f) {
+    switch (f) {
+        case SP_SELL: return "sell";
+        case SP_BCSR: return "bcsr";
+        default: return "csc";
+    }
+}
+
+#endif
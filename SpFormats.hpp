@@ -0,0 +1,128 @@
+/*
+    File:       SpFormats.hpp
+    Authors:    Matteo Loporchio, Davide Rucci
+
+    Computational Mathematics for Learning and Data Analysis 2018/2019
+*/
+
+#ifndef SPFORMATS_H
+#define SPFORMATS_H
+
+#define ARMA_DONT_USE_WRAPPER
+#include <armadillo>
+#include <vector>
+#include "Config.hpp"
+
+// Number of rows of a SELL chunk (the doubles of an AVX-512 register).
+const size_t SELL_C = 8;
+
+// Number of rows of a BCSR block.
+const size_t BCSR_R = 4;
+
+/*
+    The following formats store a sparse symmetric matrix by rows, so that
+    the products with Q are computed as dot products over its rows.
+    Since Q is symmetric, row i is built from column i of the CSC matrix.
+*/
+
+/*
+    Sliced ELLPACK format (SELL-C-sigma). The rows are sorted by decreasing
+    length within windows of SELL_SIGMA rows and grouped in chunks of
+    SELL_C rows. Each chunk is padded with zeros to the length of its
+    longest row and stored by columns, so that the SELL_C rows of a chunk
+    are processed together by the lanes of a vector register.
+*/
+template<typename eT>
+struct sellmat_t {
+    typedef eT elem_type;
+
+    arma::uword n_rows = 0;     // Number of rows.
+    arma::uword n_cols = 0;     // Number of columns.
+    std::vector<size_t> cptr;   // Offset of the entries of each chunk.
+    std::vector<cidx_t> col;    // Column of each entry (0 for padding).
+    arma::Col<eT> val;          // Value of each entry (0 for padding).
+    std::vector<cidx_t> perm;   // Row in each slot (n_rows if empty).
+    std::vector<cidx_t> pos;    // Slot of each row.
+
+    // Returns the number of chunks.
+    size_t n_chunks() const { return cptr.size() - 1; }
+
+    // Returns the length of the rows of the k-th chunk (padding included).
+    size_t width(size_t k) const { return (cptr[k + 1] - cptr[k]) / SELL_C; }
+};
+
+/*
+    Block compressed sparse row format with blocks of BCSR_R x 1 entries.
+    A block is stored whenever one of the BCSR_R rows of a block row has
+    a nonzero in the column of the block, and its BCSR_R entries are
+    multiplied by the same entry of the vector.
+*/
+template<typename eT>
+struct bcsrmat_t {
+    typedef eT elem_type;
+
+    arma::uword n_rows = 0;     // Number of rows.
+    arma::uword n_cols = 0;     // Number of columns.
+    std::vector<size_t> bptr;   // Offset of the blocks of each block row.
+    std::vector<cidx_t> col;    // Column of each block.
+    arma::Col<eT> val;          // Entries of each block (BCSR_R per block).
+};
+
+// Storage formats of a sparse matrix.
+enum spformat_t { SP_CSC = 0, SP_SELL = 1, SP_BCSR = 2 };
+
+/*
+    Sparse matrix stored in the format that best suits the distribution
+    of the lengths of its rows, which is chosen when the matrix is set
+    (see select_format). Only the member of the chosen format is used.
+*/
+template<typename eT>
+struct spauto_t {
+    typedef eT elem_type;
+
+    arma::uword n_rows = 0;         // Number of rows.
+    arma::uword n_cols = 0;         // Number of columns.
+    arma::uword n_nonzero = 0;      // Number of nonzeros.
+    spformat_t format = SP_CSC;     // Chosen format.
+    arma::SpMat<eT> S;              // Matrix in CSC format.
+    sellmat_t<eT> sell;             // Matrix in SELL-C-sigma format.
+    bcsrmat_t<eT> bcsr;             // Matrix in BCSR format.
+
+    spauto_t() {}
+    spauto_t(arma::SpMat<eT> A) { set(std::move(A)); }
+
+    // Chooses the format of A (unless forced by SP_FORMAT) and stores it.
+    // In CSC format, A is moved into the struct.
+    void set(arma::SpMat<eT> A);
+
+    // Returns the matrix in CSC format.
+    arma::SpMat<eT> to_spmat() const;
+};
+
+// Builds the SELL-C-sigma and the BCSR representations of a sparse
+// symmetric matrix.
+template<typename eT>
+void build_sell(const arma::SpMat<eT> &A, sellmat_t<eT> &B);
+
+template<typename eT>
+void build_bcsr(const arma::SpMat<eT> &A, bcsrmat_t<eT> &B);
+
+/*
+    Chooses the format of a sparse symmetric matrix from the histogram of
+    the lengths of its rows. BCSR is chosen when the rows come in groups
+    with the same pattern, so that the blocks hold few explicit zeros.
+    Otherwise, SELL-C-sigma is chosen when the rows are short and their
+    lengths are similar enough that the chunks hold little padding,
+    since CSC spends most of its time in the loop overhead of short rows.
+    CSC is kept in all the other cases.
+*/
+template<typename eT>
+spformat_t select_format(const arma::SpMat<eT> &A);
+
+// Returns the name of a sparse format.
+const char *format_name(spformat_t f);
+
+// The actual implementation is defined in the file SpFormats.cpp.
+#include "SpFormats.cpp"
+
+#endif
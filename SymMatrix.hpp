@@ -0,0 +1,65 @@
+/*
+    File:       SymMatrix.hpp
+    Authors:    Matteo Loporchio, Davide Rucci
+
+    Computational Mathematics for Learning and Data Analysis 2018/2019
+*/
+
+#ifndef SYMMATRIX_H
+#define SYMMATRIX_H
+
+#define ARMA_DONT_USE_WRAPPER
+#include <armadillo>
+
+/*
+    Dense symmetric matrix that only stores its upper triangle, packed
+    by columns: column j holds the entries U(0, j), ..., U(j, j).
+    It takes n * (n + 1) / 2 values instead of n * n.
+    The entries are stored with type eT (double or float).
+*/
+template<typename eT>
+struct symmat_t {
+    typedef eT elem_type;
+
+    arma::uword n_rows = 0;     // Number of rows.
+    arma::uword n_cols = 0;     // Number of columns.
+    arma::Col<eT> a;            // Packed entries of the upper triangle.
+
+    // Resizes the matrix to n x n (the content is not initialized).
+    void set_size(arma::uword n) {
+        n_rows = n_cols = n;
+        a.set_size(n * (n + 1) / 2);
+    }
+
+    // Returns a pointer to the packed column j (j + 1 entries).
+    const eT *colptr(arma::uword j) const {
+        return a.memptr() + j * (j + 1) / 2;
+    }
+
+    eT *colptr(arma::uword j) { return a.memptr() + j * (j + 1) / 2; }
+
+    // Returns the entry (i, j) of the full matrix.
+    eT at(arma::uword i, arma::uword j) const {
+        return (i <= j) ? colptr(j)[i] : colptr(i)[j];
+    }
+};
+
+/*
+    Sparse symmetric matrix that only stores its upper triangle
+    (diagonal included) in CSC format.
+*/
+template<typename eT>
+struct spsymmat_t {
+    typedef eT elem_type;
+
+    arma::uword n_rows = 0;     // Number of rows.
+    arma::uword n_cols = 0;     // Number of columns.
+    arma::SpMat<eT> U;          // Upper triangle.
+};
+
+typedef symmat_t<double> symmat;
+typedef symmat_t<float> fsymmat;
+typedef spsymmat_t<double> spsymmat;
+typedef spsymmat_t<float> spfsymmat;
+
+#endif
@@ -7,6 +7,7 @@
 
 #include <exception>
 #include <fstream>
+#include <future>
 #include <iomanip>
 #include <iostream>
 #include "Utils.hpp"
@@ -17,11 +18,10 @@ bool file_exists(std::string path) {
 }
 
 // Builds the full paths of the problem files and checks them.
-pfile_t check_files(std::string path, bool sparse) {
+pfile_t check_files(std::string path, const std::string &mat_suffix) {
 	// Build the names.
     std::stringstream name1, name2, name3;
-    if (sparse) name1 << path << "_Q.dat";
-	else name1 << path << "_Q.csv";
+    name1 << path << mat_suffix;
     name2 << path << "_u.csv";
     name3 << path << "_c.dat";
     std::string file1 = name1.str(), file2 = name2.str(), file3 = name3.str();
@@ -36,55 +36,362 @@ pfile_t check_files(std::string path, bool sparse) {
 }
 
 // Loads the constraints of the problem the corresponding file.
-cstlist_t load_constraints(const std::string &path,
-const std::string &delimiter) {
-	std::ifstream input(path);
-	std::string line;
+cstlist_t load_constraints(const std::string &path) {
 	cstlist_t v;
-	while (getline(input, line)) {
-		// Initialize the container.
-		std::vector<arma::uword> r;
-		// Parse the line and collect the tokens.
-		auto start = 0;
-        auto end = line.find(delimiter);
-        while (end != std::string::npos) {
-			r.push_back((arma::uword) stoi(line.substr(start, end - start)));
-            start = end + delimiter.length();
-            end = line.find(delimiter, start);
-        }
-		r.push_back((arma::uword) stoi(line.substr(start, end)));
-		// Build the vector.
-		v.push_back(arma::uvec(r));
-	}
+	parse_lists(path, v.off, v.idx);
+	return v;
+}
+
+// Loads a vector from a CSV file.
+arma::vec load_vector(const std::string &path) {
+	arma::vec v;
+	parse_flat(path, v);
 	return v;
 }
 
+// Loads q and the constraint list of a problem in the background, while
+// the caller parses the Hessian.
+struct pload_t {
+	std::future<arma::vec> q;
+	std::future<cstlist_t> c;
+};
+
+pload_t load_async(const pfile_t &files) {
+	return {std::async(std::launch::async, load_vector, files.vec_f),
+	std::async(std::launch::async, load_constraints, files.cst_f)};
+}
+
 // Loads a problem with a dense matrix from disk.
-QProblem<arma::mat> load_dense(std::string path) {
-	pfile_t files = check_files(path, false);
-    // Load Q and q from the CSV files.
-    arma::mat Q; arma::vec q;
-    Q.load(files.mat_f, arma::csv_ascii);
-    q.load(files.vec_f, arma::csv_ascii);
-	// Load the constraint list.
-	cstlist_t c = load_constraints(files.cst_f);
+template<typename eT>
+QProblem<arma::Mat<eT>> load_dense(std::string path) {
+	pfile_t files = check_files(path, "_Q.csv");
+	pload_t qc = load_async(files);
+    arma::Mat<eT> Q;
+    parse_csv(files.mat_f, Q);
+	arma::vec q = qc.q.get();
+	cstlist_t c = qc.c.get();
+	if (Q.n_rows != Q.n_cols || Q.n_rows != q.n_elem) {
+		throw std::runtime_error("The size of Q does not match the number of "
+		"variables of problem: " + path);
+	}
 	// Build and return the struct.
-    return QProblem<arma::mat>(Q, q, c);
+    return QProblem<arma::Mat<eT>>(std::move(Q), std::move(q), std::move(c));
 }
 
 // Loads a problem with a sparse matrix from disk.
-QProblem<arma::sp_mat> load_sparse(std::string path) {
-	pfile_t files = check_files(path, true);
-    // Load Q and q from the CSV files.
-    arma::sp_mat Q; arma::vec q;
-	Q.load(files.mat_f, arma::coord_ascii);
-    q.load(files.vec_f, arma::csv_ascii);
-	// Load the constraint list.
-	cstlist_t c = load_constraints(files.cst_f);
+template<typename eT>
+QProblem<spauto_t<eT>> load_sparse(std::string path) {
+	pfile_t files = check_files(path, "_Q.dat");
+	pload_t qc = load_async(files);
+    arma::SpMat<eT> Q;
+	parse_coord(files.mat_f, Q);
+	arma::vec q = qc.q.get();
+	cstlist_t c = qc.c.get();
+	// The last rows and columns of Q may be empty.
+	if (Q.n_rows > q.n_elem || Q.n_cols > q.n_elem) {
+		throw std::runtime_error("The matrix has more rows or columns than the "
+		"number of variables of problem: " + path);
+	}
+	Q.resize(q.n_elem, q.n_elem);
+	// Build and return the struct.
+    spauto_t<eT> A(std::move(Q));
+    return QProblem<spauto_t<eT>>(std::move(A), std::move(q), std::move(c));
+}
+
+// Loads a problem with a dense symmetric matrix from disk.
+// Only the entries of the upper triangle are stored while the CSV file is
+// parsed, so the full matrix is never in memory.
+template<typename eT>
+QProblem<symmat_t<eT>> load_dense_sym(std::string path) {
+	pfile_t files = check_files(path, "_Q.csv");
+	pload_t qc = load_async(files);
+    symmat_t<eT> Q;
+	parse_csv(files.mat_f, [&](size_t rows, size_t cols) {
+		if (rows < cols) {
+			throw std::runtime_error("The matrix has fewer rows than "
+			"expected: " + files.mat_f);
+		}
+		Q.set_size(cols);
+	},
+	[&Q](size_t i, size_t j, double v) {
+		if (i <= j) Q.colptr(j)[i] = (eT) v;
+	});
+	arma::vec q = qc.q.get();
+	cstlist_t c = qc.c.get();
+	if (Q.n_rows != q.n_elem) {
+		throw std::runtime_error("The size of Q does not match the number of "
+		"variables of problem: " + path);
+	}
+	// Build and return the struct.
+    return QProblem<symmat_t<eT>>(std::move(Q), std::move(q), std::move(c));
+}
+
+// Loads a problem with a sparse symmetric matrix from disk.
+// Only the entries (i, j) with i <= j are kept.
+template<typename eT>
+QProblem<spsymmat_t<eT>> load_sparse_sym(std::string path) {
+	pfile_t files = check_files(path, "_Q.dat");
+	pload_t qc = load_async(files);
+	spsymmat_t<eT> Q;
+	parse_coord(files.mat_f, Q.U, true);
+	arma::vec q = qc.q.get();
+	cstlist_t c = qc.c.get();
+	// The last rows and columns of Q may be empty.
+	if (Q.U.n_cols > q.n_elem) {
+		throw std::runtime_error("The matrix has more columns than the "
+		"number of variables of problem: " + path);
+	}
+	Q.n_rows = Q.n_cols = q.n_elem;
+	Q.U.resize(q.n_elem, q.n_elem);
+	// Build and return the struct.
+    return QProblem<spsymmat_t<eT>>(std::move(Q), std::move(q), std::move(c));
+}
+
+// Loads a problem whose Hessian is given in factored form Q = A^T * A.
+// A is stored in coordinate format, like the sparse Hessians.
+template<typename eT>
+QProblem<gram_t<eT>> load_gram(std::string path) {
+	pfile_t files = check_files(path, "_A.dat");
+	pload_t qc = load_async(files);
+    arma::SpMat<eT> A;
+	parse_coord(files.mat_f, A);
+	arma::vec q = qc.q.get();
+	cstlist_t c = qc.c.get();
+	// The last columns of A may be empty.
+	if (A.n_cols > q.n_elem) {
+		throw std::runtime_error("The factor A has more columns than the "
+		"number of variables of problem: " + path);
+	}
+	A.resize(A.n_rows, q.n_elem);
+	gram_t<eT> Q(std::move(A));
+	// Build and return the struct.
+    return QProblem<gram_t<eT>>(std::move(Q), std::move(q), std::move(c));
+}
+
+// Loads a problem whose Hessian is given in diagonal-plus-low-rank form
+// Q = D + V * V^T. Both D and V are stored as CSV files.
+template<typename eT>
+QProblem<lowrank_t<eT>> load_lowrank(std::string path) {
+	pfile_t files = check_files(path, "_V.csv");
+	std::string diag_f = path + "_D.csv";
+	if (!file_exists(diag_f)) {
+		throw std::runtime_error("Error while loading data for problem: " +
+		path + "\nPlease check if the corresponding files exist.");
+	}
+	pload_t qc = load_async(files);
+    arma::Col<eT> D; arma::Mat<eT> V;
+	parse_flat(diag_f, D);
+	parse_csv(files.mat_f, V);
+	arma::vec q = qc.q.get();
+	cstlist_t c = qc.c.get();
+	if (D.n_elem != q.n_elem || V.n_rows != q.n_elem) {
+		throw std::runtime_error("The sizes of D and V do not match the "
+		"number of variables of problem: " + path);
+	}
+	lowrank_t<eT> Q(std::move(D), std::move(V));
+	// Build and return the struct.
+    return QProblem<lowrank_t<eT>>(std::move(Q), std::move(q), std::move(c));
+}
+
+// Reads a kernel function from the corresponding file.
+kerfun_t load_kernel_fun(const std::string &path, arma::uword m) {
+	std::ifstream input(path);
+	std::string line, name;
+	getline(input, line);
+	std::stringstream tokens(line);
+	getline(tokens, name, ',');
+	name.erase(name.find_last_not_of(" \t\r") + 1);
+	kerfun_t K;
+	if (name == "linear") K.type = KER_LINEAR;
+	else if (name == "rbf") K.type = KER_RBF;
+	else if (name == "poly") K.type = KER_POLY;
+	else throw std::runtime_error("Unknown kernel in file: " + path);
+	K.gamma = (m > 0) ? 1.0 / m : 1;
+	std::string tok;
+	if (getline(tokens, tok, ',')) K.gamma = stod(tok);
+	if (getline(tokens, tok, ',')) K.coef0 = stod(tok);
+	if (getline(tokens, tok, ',')) K.degree = stoi(tok);
+	return K;
+}
+
+// Loads a problem with a kernel Hessian from disk.
+template<typename eT>
+QProblem<kermat_t<eT>> load_kermat(std::string path, double mb) {
+	pfile_t files = check_files(path, "_X.csv");
+	std::string ker_f = path + "_K.csv", lab_f = path + "_y.csv";
+	if (!file_exists(ker_f)) {
+		throw std::runtime_error("Error while loading data for problem: " +
+		path + "\nPlease check if the corresponding files exist.");
+	}
+	pload_t qc = load_async(files);
+    arma::mat X; arma::vec y;
+	parse_csv(files.mat_f, X);
+	arma::inplace_trans(X);
+	if (file_exists(lab_f)) parse_flat(lab_f, y);
+	arma::vec q = qc.q.get();
+	cstlist_t c = qc.c.get();
+	if (X.n_cols != q.n_elem || (y.n_elem > 0 && y.n_elem != q.n_elem)) {
+		throw std::runtime_error("The sizes of X and y do not match the "
+		"number of variables of problem: " + path);
+	}
+	kerfun_t K = load_kernel_fun(ker_f, X.n_rows);
+	kermat_t<eT> Q(std::move(X), K, std::move(y), mb);
+	// Build and return the struct.
+    return QProblem<kermat_t<eT>>(std::move(Q), std::move(q), std::move(c));
+}
+
+// Loads a problem with an out-of-core dense matrix from disk: only q and
+// the constraints are read, while Q is mapped in memory.
+template<typename eT>
+QProblem<mapmat_t<eT>> load_mapped(std::string path) {
+	pfile_t files = check_files(path, "_Q.bin");
+	pload_t qc = load_async(files);
+	arma::vec q = qc.q.get();
+	mapmat_t<eT> Q(files.mat_f, q.n_elem);
+	cstlist_t c = qc.c.get();
+	// Build and return the struct.
+    return QProblem<mapmat_t<eT>>(std::move(Q), std::move(q), std::move(c));
+}
+
+// Checks that a container holds a Hessian of the given kind.
+void qpb_expect(const qpb_file_t &f, qpb_kind_t kind, size_t elem_size) {
+	if (f.h->kind != kind || f.h->elem_size != elem_size) {
+		throw std::runtime_error("The binary problem file stores a "
+		"different type of Hessian (use the format of qp-convert).");
+	}
+}
+
+// Returns the n indices of a container as Armadillo indices.
+arma::uvec qpb_indices(const uint64_t *p, size_t n) {
+	arma::uvec v(n);
+	std::copy(p, p + n, v.begin());
+	return v;
+}
+
+// Reads the sparse Hessian stored in a container. The CSC arrays are
+// checked first, since Armadillo and the kernels use them without
+// bounds checking: the column pointers must go from 0 to nnz without
+// decreasing, and the row indices of each column must be increasing
+// and less than n.
+template<typename eT>
+arma::SpMat<eT> qpb_spmat(const qpb_file_t &f) {
+	const qpb_header_t &h = *f.h;
+	const uint64_t *ptr = f.sect<uint64_t>(QPB_QPTR);
+	const uint64_t *idx = f.sect<uint64_t>(QPB_QIDX);
+	bool valid = (ptr[0] == 0 && ptr[h.n] == h.nnz);
+	for (uint64_t j = 0; j < h.n && valid; j++) {
+		valid = (ptr[j] <= ptr[j + 1]);
+		for (uint64_t k = ptr[j]; k < ptr[j + 1] && valid; k++) {
+			valid = (idx[k] < h.n && (k == ptr[j] || idx[k - 1] < idx[k]));
+		}
+	}
+	if (!valid) {
+		throw std::runtime_error("Invalid sparse Hessian in the binary "
+		"problem file.");
+	}
+	return arma::SpMat<eT>(qpb_indices(f.sect<uint64_t>(QPB_QIDX), h.nnz),
+	qpb_indices(f.sect<uint64_t>(QPB_QPTR), h.n + 1),
+	arma::Col<eT>(f.sect<eT>(QPB_QVAL), h.nnz), h.n, h.n);
+}
+
+// Returns the entries of section s of a container, which can be viewed
+// by Armadillo (and changed, since the container is mapped privately).
+template<typename eT>
+eT *qpb_data(const qpb_file_t &f, qpb_sect_t s) {
+	return const_cast<eT *>(f.sect<eT>(s));
+}
+
+// Reads the Hessian stored in a container, for each type of Hessian.
+// Dense Hessians are views over the mapped file, while sparse Hessians
+// are copied (and the memory of their sections released).
+template<typename eT>
+void qpb_matrix(const qpb_file_t &f, arma::Mat<eT> &Q) {
+	qpb_expect(f, QPB_DENSE, sizeof(eT));
+	Q = arma::Mat<eT>(qpb_data<eT>(f, QPB_QVAL), f.h->n, f.h->n, false,
+	false);
+}
+
+template<typename eT>
+void qpb_matrix(const qpb_file_t &f, spauto_t<eT> &Q) {
+	qpb_expect(f, QPB_CSC, sizeof(eT));
+	Q.set(qpb_spmat<eT>(f));
+	for (qpb_sect_t s : {QPB_QVAL, QPB_QPTR, QPB_QIDX}) f.release(s);
+}
+
+template<typename eT>
+void qpb_matrix(const qpb_file_t &f, symmat_t<eT> &Q) {
+	qpb_expect(f, QPB_SYM, sizeof(eT));
+	if (f.h->nnz != f.h->n * (f.h->n + 1) / 2) {
+		throw std::runtime_error("Wrong number of entries in the binary "
+		"problem file.");
+	}
+	Q.n_rows = Q.n_cols = f.h->n;
+	Q.a = arma::Col<eT>(qpb_data<eT>(f, QPB_QVAL), f.h->nnz, false, false);
+}
+
+template<typename eT>
+void qpb_matrix(const qpb_file_t &f, spsymmat_t<eT> &Q) {
+	qpb_expect(f, QPB_SPSYM, sizeof(eT));
+	Q.n_rows = Q.n_cols = f.h->n;
+	Q.U = qpb_spmat<eT>(f);
+	for (qpb_sect_t s : {QPB_QVAL, QPB_QPTR, QPB_QIDX}) f.release(s);
+}
+
+// Loads a problem from a binary container. The file is mapped privately
+// and kept alive by the problem, whose q (and dense Q) are views over it.
+template<typename T>
+QProblem<T> load_binary(std::string path) {
+	qpb_file_t f = qpb_open(path + ".qpb", QPB_VERIFY, true);
+	const qpb_header_t &h = *f.h;
+	T Q;
+	qpb_matrix(f, Q);
+	arma::vec q(qpb_data<double>(f, QPB_Q), h.n, false, false);
+	// The constraint list is checked, since its indices are used
+	// without bounds checking by the solver.
+	const uint64_t *off = f.sect<uint64_t>(QPB_COFF);
+	const uint64_t *idx = f.sect<uint64_t>(QPB_CIDX);
+	cstlist_t c;
+	c.off.assign(off, off + h.k + 1);
+	c.idx.assign(idx, idx + h.n_idx);
+	bool valid = (off[0] == 0 && off[h.k] == h.n_idx);
+	for (uint64_t b = 0; b < h.k && valid; b++) valid = (off[b] <= off[b + 1]);
+	for (uint64_t j = 0; j < h.n_idx && valid; j++) valid = (idx[j] < h.n);
+	if (!valid) {
+		throw std::runtime_error("Invalid constraints in binary problem file: "
+		+ path + ".qpb");
+	}
+	f.release(QPB_COFF);
+	f.release(QPB_CIDX);
 	// Build and return the struct.
-    return QProblem<arma::sp_mat>(Q, q, c);
+    return QProblem<T>(std::move(Q), std::move(q), std::move(c), f.map);
 }
 
+// Instances of the loaders for double and single precision.
+template QProblem<arma::Mat<double>> load_dense(std::string path);
+template QProblem<arma::Mat<float>> load_dense(std::string path);
+template QProblem<spauto_t<double>> load_sparse(std::string path);
+template QProblem<spauto_t<float>> load_sparse(std::string path);
+template QProblem<symmat_t<double>> load_dense_sym(std::string path);
+template QProblem<symmat_t<float>> load_dense_sym(std::string path);
+template QProblem<spsymmat_t<double>> load_sparse_sym(std::string path);
+template QProblem<spsymmat_t<float>> load_sparse_sym(std::string path);
+template QProblem<gram_t<double>> load_gram(std::string path);
+template QProblem<gram_t<float>> load_gram(std::string path);
+template QProblem<lowrank_t<double>> load_lowrank(std::string path);
+template QProblem<lowrank_t<float>> load_lowrank(std::string path);
+template QProblem<kermat_t<double>> load_kermat(std::string path, double mb);
+template QProblem<kermat_t<float>> load_kermat(std::string path, double mb);
+template QProblem<mapmat_t<double>> load_mapped(std::string path);
+template QProblem<mapmat_t<float>> load_mapped(std::string path);
+template QProblem<arma::Mat<double>> load_binary(std::string path);
+template QProblem<arma::Mat<float>> load_binary(std::string path);
+template QProblem<spauto_t<double>> load_binary(std::string path);
+template QProblem<spauto_t<float>> load_binary(std::string path);
+template QProblem<symmat_t<double>> load_binary(std::string path);
+template QProblem<symmat_t<float>> load_binary(std::string path);
+template QProblem<spsymmat_t<double>> load_binary(std::string path);
+template QProblem<spsymmat_t<float>> load_binary(std::string path);
+
 // Saves the content of a std::vector into a file.
 void vector_to_file(const std::vector<double> &v, std::string path) {
     std::ofstream output(path);
@@ -11,6 +11,7 @@
 #include <exception>
 #include "Problem.hpp"
 #include "Config.hpp"
+#include "Parse.hpp"
 
 // This struct is used to represent the paths of the files of a problem.
 struct pfile_t {
@@ -22,18 +23,75 @@ struct pfile_t {
 // Checks if a given file exists.
 bool file_exists(std::string path);
 
-// Builds the full paths of the problem files and checks them.
-pfile_t check_files(std::string path, bool sparse);
+// Builds the full paths of the problem files and checks them: the matrix
+// is read from the file <path><mat_suffix> (e.g. "_Q.csv" or "_Q.dat").
+pfile_t check_files(std::string path, const std::string &mat_suffix);
 
 // Loads the constraints of the problem the corresponding file.
-cstlist_t load_constraints(const std::string &path,
-const std::string &delimiter = ",");
+cstlist_t load_constraints(const std::string &path);
+
+// Loads a vector from a CSV file.
+arma::vec load_vector(const std::string &path);
+
+/*
+    The following functions load a problem from disk. The text files are
+    parsed in parallel (see Parse.hpp), and q and the constraint list are
+    loaded in the background while the Hessian is parsed.
+    The template parameter is the type of the entries of the Hessian:
+    double or float (single precision, see the class QProblem).
+*/
 
 // Loads a problem with a dense matrix from disk.
-QProblem<arma::mat> load_dense(std::string path);
+template<typename eT = double>
+QProblem<arma::Mat<eT>> load_dense(std::string path);
+
+// Loads a problem with a sparse matrix from disk. The matrix is stored
+// in the format chosen by spauto_t.
+template<typename eT = double>
+QProblem<spauto_t<eT>> load_sparse(std::string path);
+
+// Loads a problem with a dense symmetric matrix from disk,
+// keeping only the upper triangle of the matrix.
+template<typename eT = double>
+QProblem<symmat_t<eT>> load_dense_sym(std::string path);
+
+// Loads a problem with a sparse symmetric matrix from disk,
+// keeping only the upper triangle of the matrix.
+template<typename eT = double>
+QProblem<spsymmat_t<eT>> load_sparse_sym(std::string path);
+
+// Loads a problem whose Hessian is given in factored form Q = A^T * A,
+// reading the sparse m x n matrix A from the file <path>_A.dat.
+template<typename eT = double>
+QProblem<gram_t<eT>> load_gram(std::string path);
+
+// Loads a problem whose Hessian is given as Q = D + V * V^T, reading the
+// diagonal of D from <path>_D.csv and the n x r matrix V from <path>_V.csv.
+template<typename eT = double>
+QProblem<lowrank_t<eT>> load_lowrank(std::string path);
+
+// Reads a kernel function from a file with a single line of the form
+// <name>[,<gamma>[,<coef0>[,<degree>]]], where name is linear, rbf or poly.
+// If missing, gamma is 1 / m for m features.
+kerfun_t load_kernel_fun(const std::string &path, arma::uword m);
+
+// Loads a problem with a kernel Hessian, reading the n x m matrix of
+// features from <path>_X.csv, the kernel from <path>_K.csv and (if the file
+// exists) the labels from <path>_y.csv. Columns of Q are cached in at most
+// mb megabytes.
+template<typename eT = double>
+QProblem<kermat_t<eT>> load_kermat(std::string path, double mb = KCACHE_MB);
+
+// Loads a problem with an out-of-core dense matrix, which is mapped from
+// the file <path>_Q.bin (the n x n entries of Q in column-major order).
+template<typename eT = double>
+QProblem<mapmat_t<eT>> load_mapped(std::string path);
 
-// Loads a problem with a sparse matrix from disk.
-QProblem<arma::sp_mat> load_sparse(std::string path);
+// Loads a problem from the binary container <path>.qpb (see Binary.hpp).
+// T must match the Hessian stored in the file: arma::Mat, spauto_t,
+// symmat_t or spsymmat_t, with the same type of entries.
+template<typename T>
+QProblem<T> load_binary(std::string path);
 
 // Saves the content of a std::vector into a file.
 void vector_to_file(const std::vector<double> &v, std::string path);
@@ -0,0 +1,75 @@
+/*
+    File:       bench_spmv.cpp
+    Authors:    Matteo Loporchio, Davide Rucci
+
+    Computational Mathematics for Learning and Data Analysis 2018/2019
+
+    This micro-benchmark compares the sparse product 2 * Q * d computed
+    through the Armadillo expression used in the original implementation
+    with the dedicated kernel defined in Kernels.cpp, on the CSC matrix and
+    on the format chosen automatically by spauto_t.
+    For each problem, a line is written on the standard output with the
+    following comma-separated fields:
+
+        name, n, nnz, format, expression time (us), kernel time (us),
+        automatic format time (us), max. error
+
+    where the times are averages over the given number of products.
+    The kernel uses as many threads as set by OMP_NUM_THREADS.
+*/
+
+#include <chrono>
+#include <iostream>
+#include "Kernels.hpp"
+#include "Utils.hpp"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// Returns the average time in microseconds of a call to fun().
+template<typename F>
+double timeit(F fun, unsigned int repeat) {
+    auto t1 = std::chrono::high_resolution_clock::now();
+    for (unsigned int r = 0; r < repeat; r++) fun();
+    auto t2 = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1)
+    .count() / (double) repeat;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        std::cerr << "Usage:" << std::endl
+        << argv[0] << " <repeat> <name_1> [<name_2> ...]" << std::endl;
+        return 1;
+    }
+    unsigned int repeat = ((unsigned int) atoi(argv[1]));
+    #ifdef _OPENMP
+    int threads = omp_get_max_threads();
+    #else
+    int threads = 1;
+    #endif
+    for (int i = 2; i < argc; i++) {
+        std::string path = std::string(argv[i]) + "_Q.dat";
+        if (!file_exists(path)) {
+            std::cerr << "Cannot find file: " << path << std::endl;
+            return 1;
+        }
+        arma::sp_mat Q;
+        Q.load(path, arma::coord_ascii);
+        spauto_t<double> A(Q);
+        arma::vec d = arma::randu(Q.n_cols), l1(Q.n_rows), l2(Q.n_rows),
+        l3(Q.n_rows);
+        std::vector<size_t> part, apart;
+        split(Q, nullptr, Q.n_cols, threads, part);
+        split(A, nullptr, Q.n_cols, threads, apart);
+        double t_expr = timeit([&]() { l1 = 2 * Q * d; }, repeat);
+        double t_kern = timeit([&]() { mul(Q, 2, d, l2, part); }, repeat);
+        double t_auto = timeit([&]() { mul(A, 2, d, l3, apart); }, repeat);
+        double err = std::max(arma::abs(l1 - l2).max(),
+        arma::abs(l1 - l3).max());
+        std::cout << argv[i] << "," << Q.n_rows << "," << Q.n_nonzero << ","
+        << format_name(A.format) << "," << t_expr << "," << t_kern << ","
+        << t_auto << "," << err << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,123 @@
+/*
+    File:       example_op.cpp
+    Authors:    Matteo Loporchio, Davide Rucci
+
+    Computational Mathematics for Learning and Data Analysis 2018/2019
+
+    Example of a matrix-free Hessian operator (see Operator.hpp). The
+    sparse matrix of a problem is hidden behind a class that only exposes
+    the products, the diagonal and the columns of Q, and the problem is
+    solved through QProblem<op_t<...>>. The result is checked against the
+    one obtained with the sparse matrix itself, and the following line is
+    written on the standard output:
+
+        name, value (operator), value (matrix), max. error on x,
+        iterations (operator), iterations (matrix), allocations of the
+        first run (operator), allocations of the first run (matrix)
+
+    Each problem is then solved again in the same workspace. The program
+    fails if the two solutions differ, or if the second runs allocate any
+    buffer during their iterations.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include "Problem.hpp"
+#include "Utils.hpp"
+
+// Matrix-free view of a sparse matrix in CSC form.
+struct csc_op_t {
+    arma::uword n_rows, n_cols;
+    arma::sp_mat S;
+
+    csc_op_t(const arma::sp_mat &S) : n_rows(S.n_rows), n_cols(S.n_cols),
+    S(S) {}
+
+    // y = alpha * Q * x.
+    void apply(double alpha, const arma::vec &x, arma::vec &y) const {
+        y.zeros(n_rows);
+        for (arma::uword j = 0; j < n_cols; j++) {
+            double xj = alpha * x(j);
+            for (arma::uword k = S.col_ptrs[j]; k < S.col_ptrs[j + 1]; k++) {
+                y(S.row_indices[k]) += S.values[k] * xj;
+            }
+        }
+    }
+
+    // y = Q * x.
+    void apply(const arma::vec &x, arma::vec &y) const { apply(1.0, x, y); }
+
+    // Q(i, i).
+    double diag(arma::uword i) const { return S(i, i); }
+
+    // Q(:, j).
+    void column(arma::uword j, double *c) const {
+        std::fill(c, c + n_rows, 0.0);
+        for (arma::uword k = S.col_ptrs[j]; k < S.col_ptrs[j + 1]; k++) {
+            c[S.row_indices[k]] = S.values[k];
+        }
+    }
+};
+
+int main(int argc, char **argv) {
+    if (argc < 5) {
+        std::cerr << "Usage:" << std::endl
+        << argv[0] << " <name> <max_iter> <ctol> <dtol>" << std::endl;
+        return 1;
+    }
+    std::string path(argv[1]);
+    unsigned int max_iter = ((unsigned int) atoi(argv[2]));
+    double ctol = atof(argv[3]), dtol = atof(argv[4]);
+    try {
+        pfile_t files = check_files(path, "_Q.dat");
+        arma::sp_mat S;
+        parse_coord(files.mat_f, S);
+        arma::vec q = load_vector(files.vec_f);
+        cstlist_t c = load_constraints(files.cst_f);
+        if (S.n_rows != q.n_elem || S.n_cols != q.n_elem) {
+            S.resize(q.n_elem, q.n_elem);
+        }
+        // The optional members of the operator are used by op_t.
+        op_t<csc_op_t> Q(csc_op_t{S});
+        for (arma::uword i = 0; i < q.n_elem; i++) {
+            if (diag(Q, i) != S(i, i)) {
+                std::cerr << "Wrong diagonal entry: " << i << std::endl;
+                return 1;
+            }
+        }
+        QProblem<op_t<csc_op_t>> P(std::move(Q), arma::vec(q), cstlist_t(c));
+        QProblem<spauto_t<double>> M(spauto_t<double>(S), std::move(q),
+        std::move(c));
+        #if REORDER
+        P.reorder();
+        M.reorder();
+        #endif
+        PGMWorkspace ws1, ws2;
+        QResult R1 = P.PGM(P.initial_point(), max_iter, ctol, dtol, ws1);
+        QResult R2 = M.PGM(M.initial_point(), max_iter, ctol, dtol, ws2);
+        double err = arma::abs(R1.x - R2.x).max();
+        std::cout << path << ", " << R1.v << ", " << R2.v << ", " << err
+        << ", " << R1.n_iter << ", " << R2.n_iter << ", " << R1.n_alloc
+        << ", " << R2.n_alloc << std::endl;
+        if (!P.is_feasible(R1.x, ctol) ||
+        std::abs(R1.v - R2.v) > 1E-8 * std::max(1.0, std::abs(R2.v)) ||
+        err > 1E-6) {
+            std::cerr << "The two solutions differ." << std::endl;
+            return 1;
+        }
+        // The buffers are all sized by the first runs.
+        R1 = P.PGM(P.initial_point(), max_iter, ctol, dtol, ws1);
+        R2 = M.PGM(M.initial_point(), max_iter, ctol, dtol, ws2);
+        if (R1.n_alloc != 0 || R2.n_alloc != 0) {
+            std::cerr << "The iterations of a second run allocated memory."
+            << std::endl;
+            return 1;
+        }
+    }
+    catch (std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -11,12 +11,60 @@
 #include <iomanip>
 #include <iostream>
 
+// Solves a problem starting from the default initial point. The problem
+// returned by a loader is built directly in P, without copies.
+template<typename T>
+QResult solve(QProblem<T> P, unsigned int max_iter, double ctol, double dtol,
+bool log, bool &feasible) {
+    #if REORDER
+    P.reorder();
+    #endif
+    arma::vec x_0 = P.initial_point();
+    QResult R = P.PGM(x_0, max_iter, ctol, dtol, log);
+    feasible = P.is_feasible(R.x, ctol);
+    return R;
+}
+
+// Solves a problem stored in a binary container, whose type of Hessian
+// is read from the header of the file.
+QResult solve_binary(const std::string &path, unsigned int max_iter,
+double ctol, double dtol, bool log, bool &feasible) {
+    qpb_file_t f = qpb_open(path + ".qpb", false);
+    bool single = (f.h->elem_size == sizeof(float));
+    switch (f.h->kind) {
+        case QPB_DENSE:
+            return (single) ?
+            solve(load_binary<arma::fmat>(path), max_iter, ctol, dtol, log,
+            feasible) :
+            solve(load_binary<arma::mat>(path), max_iter, ctol, dtol, log,
+            feasible);
+        case QPB_CSC:
+            return (single) ?
+            solve(load_binary<spauto_t<float>>(path), max_iter, ctol, dtol,
+            log, feasible) :
+            solve(load_binary<spauto_t<double>>(path), max_iter, ctol, dtol,
+            log, feasible);
+        case QPB_SYM:
+            return (single) ?
+            solve(load_binary<fsymmat>(path), max_iter, ctol, dtol, log,
+            feasible) :
+            solve(load_binary<symmat>(path), max_iter, ctol, dtol, log,
+            feasible);
+        default:
+            return (single) ?
+            solve(load_binary<spfsymmat>(path), max_iter, ctol, dtol, log,
+            feasible) :
+            solve(load_binary<spsymmat>(path), max_iter, ctol, dtol, log,
+            feasible);
+    }
+}
+
 int main(int argc, char **argv) {
     // Read the parameters.
     if (argc < 6) {
         std::cerr << "Usage:" << std::endl
-        << argv[0] << " <name> <max_iter> <ctol> <dtol> <sparse>"
-        << std::endl;
+        << argv[0] << " <name> <max_iter> <ctol> <dtol> <format> [<log>]"
+        << " [<cache_mb>]" << std::endl;
         return 1;
     }
     // Name of the data set.
@@ -24,22 +72,87 @@ int main(int argc, char **argv) {
     // Read the parameters from the command line.
     unsigned int max_iter = ((unsigned int) atoi(argv[2]));
     double ctol = atof(argv[3]), dtol = atof(argv[4]);
-    int sparse = atoi(argv[5]);
+    int format = atoi(argv[5]);
+    bool log = ((argc > 6) ? atoi(argv[6]) : LOG_VAL);
+    double cache_mb = ((argc > 7) ? atof(argv[7]) : KCACHE_MB);
+    if (cache_mb < 0) {
+        std::cerr << "The size of the cache cannot be negative." << std::endl;
+        return 1;
+    }
     // Load and solve the problem.
     QResult R;
     bool feasible = false;
     try {
-        if (sparse) {
-            QProblem<arma::sp_mat> P = load_sparse(path);
-            arma::vec x_0 = P.initial_point();
-            R = P.PGM(x_0, max_iter, ctol, dtol);
-            feasible = P.is_feasible(R.x, ctol);
-        }
-        else {
-            QProblem<arma::mat> P = load_dense(path);
-            arma::vec x_0 = P.initial_point();
-            R = P.PGM(x_0, max_iter, ctol, dtol);
-            feasible = P.is_feasible(R.x, ctol);
+        switch (format) {
+            case 0:
+                R = solve(load_dense(path), max_iter, ctol, dtol, log, feasible);
+                break;
+            case 1:
+                R = solve(load_sparse(path), max_iter, ctol, dtol, log,
+                feasible);
+                break;
+            case 2:
+                R = solve(load_dense_sym(path), max_iter, ctol, dtol, log,
+                feasible);
+                break;
+            case 3:
+                R = solve(load_sparse_sym(path), max_iter, ctol, dtol, log,
+                feasible);
+                break;
+            case 4:
+                R = solve(load_dense<float>(path), max_iter, ctol, dtol, log,
+                feasible);
+                break;
+            case 5:
+                R = solve(load_sparse<float>(path), max_iter, ctol, dtol, log,
+                feasible);
+                break;
+            case 6:
+                R = solve(load_dense_sym<float>(path), max_iter, ctol, dtol,
+                log, feasible);
+                break;
+            case 7:
+                R = solve(load_sparse_sym<float>(path), max_iter, ctol, dtol,
+                log, feasible);
+                break;
+            case 8:
+                R = solve(load_gram(path), max_iter, ctol, dtol, log,
+                feasible);
+                break;
+            case 9:
+                R = solve(load_gram<float>(path), max_iter, ctol, dtol, log,
+                feasible);
+                break;
+            case 10:
+                R = solve(load_lowrank(path), max_iter, ctol, dtol, log,
+                feasible);
+                break;
+            case 11:
+                R = solve(load_lowrank<float>(path), max_iter, ctol, dtol, log,
+                feasible);
+                break;
+            case 12:
+                R = solve(load_kermat(path, cache_mb), max_iter, ctol, dtol,
+                log, feasible);
+                break;
+            case 13:
+                R = solve(load_kermat<float>(path, cache_mb), max_iter, ctol,
+                dtol, log, feasible);
+                break;
+            case 14:
+                R = solve(load_mapped(path), max_iter, ctol, dtol, log,
+                feasible);
+                break;
+            case 15:
+                R = solve(load_mapped<float>(path), max_iter, ctol, dtol, log,
+                feasible);
+                break;
+            case 16:
+                R = solve_binary(path, max_iter, ctol, dtol, log, feasible);
+                break;
+            default:
+                std::cerr << "Unknown format: " << format << std::endl;
+                return 1;
         }
     }
     catch (std::exception &e) {
@@ -53,8 +166,6 @@ int main(int argc, char **argv) {
     << "Feasible\t= " << feasible << std::endl
     << "Time\t\t= " << R.time << " us" << std::endl;
     // Write the value history to a file.
-    #if LOG_VAL
-    vector_to_file(R.hist, path + "_val.csv");
-    #endif
+    if (log) vector_to_file(R.hist, path + "_val.csv");
     return 0;
 }
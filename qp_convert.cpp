@@ -0,0 +1,84 @@
+/*
+    File:       qp_convert.cpp
+    Authors:    Matteo Loporchio, Davide Rucci
+
+    Computational Mathematics for Learning and Data Analysis 2018/2019
+
+    This tool converts the text files of a problem (<name>_Q.csv or
+    <name>_Q.dat, <name>_u.csv and <name>_c.dat) into a binary container
+    (see Binary.hpp), which can then be loaded by qp-solver with format 16.
+    The format of the input has the same meaning as for qp-solver (0-7).
+    With --check, the header and the checksum of a container are verified.
+*/
+
+#include <exception>
+#include <iostream>
+#include "Utils.hpp"
+
+// Names of the kinds of Hessian.
+const char *kind_name(uint32_t kind) {
+    switch (kind) {
+        case QPB_DENSE: return "dense";
+        case QPB_CSC: return "sparse";
+        case QPB_SYM: return "dense symmetric";
+        default: return "sparse symmetric";
+    }
+}
+
+// Prints the header of a container, verifying its checksum.
+void check(const std::string &path) {
+    qpb_file_t f = qpb_open(path, true);
+    const qpb_header_t &h = *f.h;
+    std::cout << "File\t\t= " << path << std::endl
+    << "Version\t\t= " << h.version << std::endl
+    << "Hessian\t\t= " << kind_name(h.kind) << " ("
+    << ((h.elem_size == sizeof(float)) ? "single" : "double")
+    << " precision)" << std::endl
+    << "Variables\t= " << h.n << std::endl
+    << "Blocks\t\t= " << h.k << std::endl
+    << "Entries\t\t= " << h.nnz << std::endl
+    << "Checksum\t= " << std::hex << h.checksum << std::dec << " (OK)"
+    << std::endl;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        std::cerr << "Usage:" << std::endl
+        << argv[0] << " <name> <format> [<output>]" << std::endl
+        << argv[0] << " --check <file>" << std::endl;
+        return 1;
+    }
+    std::string path(argv[1]);
+    try {
+        if (path == "--check") {
+            check(argv[2]);
+            return 0;
+        }
+        int format = atoi(argv[2]);
+        // The container of a problem is always named <name>.qpb, which is
+        // the file read by qp-solver with format 16.
+        std::string out = ((argc > 3) ? std::string(argv[3]) : path);
+        if (out.size() < 4 || out.compare(out.size() - 4, 4, ".qpb") != 0) {
+            out += ".qpb";
+        }
+        switch (format) {
+            case 0: load_dense(path).save(out); break;
+            case 1: load_sparse(path).save(out); break;
+            case 2: load_dense_sym(path).save(out); break;
+            case 3: load_sparse_sym(path).save(out); break;
+            case 4: load_dense<float>(path).save(out); break;
+            case 5: load_sparse<float>(path).save(out); break;
+            case 6: load_dense_sym<float>(path).save(out); break;
+            case 7: load_sparse_sym<float>(path).save(out); break;
+            default:
+                std::cerr << "Unknown format: " << format << std::endl;
+                return 1;
+        }
+        check(out);
+    }
+    catch (std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,27 @@
+#!/bin/bash
+#
+#   File:     spmv_bench.sh
+#   Authors:  Matteo Loporchio, Davide Rucci
+#
+#   This bash script runs the sparse matrix-vector product micro-benchmark
+#   on all the sparse problems of a test folder and collects the results
+#   in a CSV file.
+#
+
+TEST_PATH="test_sparse"
+SUFFIX="_Q.dat"
+BENCH_PATH="./../qp-bench"
+OUTFILE="spmv_bench.csv"
+TEST_LIST=( "${TEST_PATH}/*${SUFFIX}" )
+REPEAT=100
+
+# Open the output file.
+exec 3>$OUTFILE
+echo "name,n,nnz,format,t_expr,t_kernel,t_auto,err" 1>&3
+# Process each test case.
+for TESTCASE_P in $TEST_LIST; do
+    # Obtain the name of the data set.
+    TESTCASE=${TESTCASE_P%"$SUFFIX"}
+    echo "Processing ${TESTCASE}..."
+    ${BENCH_PATH} ${REPEAT} ${TESTCASE} 1>&3
+done